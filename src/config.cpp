@@ -26,6 +26,8 @@
 #include "skse64/PapyrusKeyword.h"
 #include "skse64/PapyrusGameData.cpp"
 
+#include <algorithm>
+
 
 bool   CQuickslotManager::ReadConfig(const char* filename)
 {
@@ -48,6 +50,8 @@ bool   CQuickslotManager::ReadConfig(const char* filename)
 		return false;
 	}
 
+	StopWorkerThread();  // worker must not touch quickslot data while it is rebuilt, restarted below if still enabled
+	BeginReload();  // neither must the hooks, which now process frames inline
 	Reset();  // reset current quickslot data
 
 	// special case setup for spellsiphon
@@ -67,19 +71,69 @@ bool   CQuickslotManager::ReadConfig(const char* filename)
 			elem->QueryIntAttribute("disablerawapi", &mDisableRawAPI);
 			elem->QueryDoubleAttribute("longpresstime", &mLongPressTime);
 			elem->QueryDoubleAttribute("hoverquickslothaptictime", &mHoverQuickslotHapticTime);
+			elem->QueryIntAttribute("hmdlocalquery", &mHMDLocalQuery);
+			elem->QueryIntAttribute("usetrackers", &mUseTrackers);
+			elem->QueryIntAttribute("poseextrapolation", &mPoseExtrapolation);
+			elem->QueryDoubleAttribute("maxposeextrapolationtime", &mMaxPoseExtrapolationTime);
+			elem->QueryIntAttribute("profilehooks", &mProfileHooks);
+			elem->QueryIntAttribute("workerthread", &mUseWorkerThread);
+			elem->QueryIntAttribute("workerthreadcore", &mWorkerThreadCore);
+			elem->QueryString2Attribute("posetracefile", &mPoseTraceFile);
+			elem->QueryString2Attribute("posetracereplay", &mPoseTraceReplayFile);
+			elem->QueryDoubleAttribute("consoleframebudget", &mConsoleFrameBudget);
+			elem->QueryIntAttribute("inventoryindex", &mUseInventoryIndex);
 			
 			int activateButtonId = 0;
 			elem->QueryIntAttribute("activatebutton", &activateButtonId);
-			if(activateButtonId!=0)
+			if (activateButtonId > 0 && activateButtonId < 64)  // button bits are 64 bit masks
 			{
 				mActivateButton = (PapyrusVR::EVRButtonId)activateButtonId;
 			}
+			else if (activateButtonId != 0)
+			{
+				QSLOG_ERR("Invalid activatebutton %d, keeping button %d", activateButtonId, (int)mActivateButton);
+			}
 
 			mControllerRadius = mDefaultRadius;
 
 			elem->QueryFloatAttribute("controllerradius", &mControllerRadius);
 
 			CUtil::GetSingleton().SetLogLevel(mDebugLogVerb);
+
+			mPosesHookProfiler.SetEnabled(mProfileHooks != 0);
+			mControllerHookProfiler.SetEnabled(mProfileHooks != 0);
+
+			trim(mPoseTraceFile);
+			trim(mPoseTraceReplayFile);
+			if (!mPoseTraceFile.empty() && !mPoseTraceReplayFile.empty())
+			{
+				QSLOG_ERR("posetracefile is ignored while posetracereplay is set, a replay would record itself");
+			}
+			else if (!mPoseTraceFile.empty() && !mPoseTraceRecorder.IsOpen())
+			{
+				mPoseTraceRecorder.Open(mPoseTraceFile.c_str());
+			}
+		}
+		else if (strcmp(elem->Name(), "binding") == 0)
+		{
+			QuickslotBinding binding;
+			int button = -1;
+
+			elem->QueryIntAttribute("button", &button);
+			elem->QueryIntAttribute("longpress", &binding.mLongPress);
+			elem->QueryFloatAttribute("pressthreshold", &binding.mPressThreshold);
+			binding.mReleaseThreshold = std::max<float>(binding.mPressThreshold - 0.1f, 0.0f);  // default hysteresis
+			elem->QueryFloatAttribute("releasethreshold", &binding.mReleaseThreshold);
+
+			if (button >= 0 && button < 64)
+			{
+				binding.mButton = (PapyrusVR::EVRButtonId)button;
+				mBindings.push_back(binding);
+			}
+			else
+			{
+				QSLOG_ERR("Invalid button %d in binding, skipping", button);
+			}
 		}
 		else if (strcmp(elem->Name(), "quickslot") == 0)
 		{
@@ -300,6 +354,8 @@ bool   CQuickslotManager::ReadConfig(const char* filename)
 
 					// get which slot to use
 					subElem->QueryIntAttribute("slot", &cmd.mSlot);
+					// optionally restrict command to one binding button
+					subElem->QueryIntAttribute("button", &cmd.mButton);
 
 					if (subElem->GetText())
 					{
@@ -319,6 +375,22 @@ bool   CQuickslotManager::ReadConfig(const char* filename)
 		}
 	}
 
+	for (auto& quickslot : mQuickslotArray)
+	{
+		quickslot.PrepareCommands();
+	}
+
+	RebuildQuickslotGeometry();
+	RebuildBindings();
+	InvalidateInteractionDevices();  // pick up usetrackers changes
+
+	EndReload();
+
+	if (mUseWorkerThread)
+	{
+		StartWorkerThread(mWorkerThreadCore);
+	}
+
 	QSLOG("Finished reading %s - debugloglevel=%d", filename, mDebugLogVerb);
 
 	return true;
@@ -348,9 +420,66 @@ bool	CQuickslotManager::WriteConfig(const char* filename)
 	options->SetAttribute("controllerradius", mControllerRadius);
 	options->SetAttribute("hoverquickslothaptictime", mHoverQuickslotHapticTime);
 	options->SetAttribute("activatebutton", mActivateButton);	
+	if (mHMDLocalQuery)
+	{
+		options->SetAttribute("hmdlocalquery", mHMDLocalQuery);
+	}
+	if (mUseTrackers)
+	{
+		options->SetAttribute("usetrackers", mUseTrackers);
+	}
+	if (mPoseExtrapolation)
+	{
+		options->SetAttribute("poseextrapolation", mPoseExtrapolation);
+		options->SetAttribute("maxposeextrapolationtime", mMaxPoseExtrapolationTime);
+	}
+	if (mUseWorkerThread)
+	{
+		options->SetAttribute("workerthread", mUseWorkerThread);
+		options->SetAttribute("workerthreadcore", mWorkerThreadCore);
+	}
+	if (mProfileHooks)
+	{
+		options->SetAttribute("profilehooks", mProfileHooks);
+	}
+	if (!mPoseTraceFile.empty())
+	{
+		options->SetAttribute("posetracefile", mPoseTraceFile.c_str());
+	}
+	if (!mPoseTraceReplayFile.empty())
+	{
+		options->SetAttribute("posetracereplay", mPoseTraceReplayFile.c_str());
+	}
+	if (mConsoleFrameBudget > 0.0)
+	{
+		options->SetAttribute("consoleframebudget", mConsoleFrameBudget);
+	}
+	if (!mUseInventoryIndex)
+	{
+		options->SetAttribute("inventoryindex", mUseInventoryIndex);
+	}
 
 	root->InsertFirstChild(options);
 
+	for (size_t i = 0; i < mBindings.size(); ++i)
+	{
+		// the activatebutton binding (first) is already written in options, it only needs an element for non-default settings
+		if (i == 0 && mBindings[i].mLongPress == QuickslotBinding().mLongPress && mBindings[i].mPressThreshold <= 0.0f)
+		{
+			continue;
+		}
+
+		tinyxml2::XMLElement* bindingElem = xmldoc.NewElement("binding");
+		bindingElem->SetAttribute("button", mBindings[i].mButton);
+		bindingElem->SetAttribute("longpress", mBindings[i].mLongPress);
+		if (mBindings[i].mPressThreshold > 0.0f)
+		{
+			bindingElem->SetAttribute("pressthreshold", mBindings[i].mPressThreshold);
+			bindingElem->SetAttribute("releasethreshold", mBindings[i].mReleaseThreshold);
+		}
+		root->InsertEndChild(bindingElem);
+	}
+
 	// lambda func for processing command actions and writing to XML (will be used in loop below)
 	auto WriteAction = [&](const CQuickslot::CQuickslotCmd& cmd, tinyxml2::XMLElement* qselem, int order)
 	{
@@ -464,6 +593,11 @@ bool	CQuickslotManager::WriteConfig(const char* filename)
 			actionElem->SetAttribute("slot", cmd.mSlot);
 		}
 
+		if (cmd.mButton >= 0)
+		{
+			actionElem->SetAttribute("button", cmd.mButton);
+		}
+
 		qselem->InsertEndChild(actionElem);
 
 	};
@@ -476,7 +610,7 @@ bool	CQuickslotManager::WriteConfig(const char* filename)
 		// do quickslot settings
 		quickslotElem->SetAttribute("name", it->mName.c_str());
 		quickslotElem->SetAttribute("radius", it->mRadius);
-		// IMPORTANT: write the origin position (pre-transformed) not mPosition
+		// IMPORTANT: write the origin position (pre-transformed)
 		quickslotElem->SetAttribute("posx", it->mOrigin.x);
 		quickslotElem->SetAttribute("posy", it->mOrigin.y);
 		quickslotElem->SetAttribute("posz", it->mOrigin.z);
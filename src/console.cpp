@@ -5,9 +5,20 @@
 
 
 IMenu* CSkyrimConsole::sConsoleMenu = nullptr;
+CTimer CSkyrimConsole::sTimer;
 
 void CSkyrimConsole::RunCommand(const char* cmd)
 {
+	RunCommands(&cmd, 1);
+}
+
+size_t CSkyrimConsole::RunCommands(const char* const* cmds, size_t numCmds, double timeBudget, double* outCommandTimes)
+{
+	if (numCmds == 0)
+	{
+		return 0;
+	}
+
 	if (!sConsoleMenu) 
 	{
 		QSLOG_INFO("Trying to create Console menu");
@@ -24,19 +35,44 @@ void CSkyrimConsole::RunCommand(const char* cmd)
 		resphash.data.number = -1;
 		GFxValue commandVal;
 		commandVal.type = GFxValue::kType_String;
-		commandVal.data.string = cmd;
 		GFxValue args[3];
 		args[0] = methodName;
 		args[1] = resphash;
 		args[2] = commandVal;
 
-		GFxValue resp;
-		sConsoleMenu->view->Invoke("flash.external.ExternalInterface.call", &resp, args, 3);
+		// the console executes one command per ExecuteCommand call, only the command argument changes
+		const double startTime = sTimer.GetTime();
+		double commandStartTime = startTime;
+		for (size_t i = 0; i < numCmds; ++i)
+		{
+			args[2].data.string = cmds[i];
+
+			GFxValue resp;
+			sConsoleMenu->view->Invoke("flash.external.ExternalInterface.call", &resp, args, 3);
+
+			const double commandEndTime = sTimer.GetTime();
+			if (outCommandTimes)
+			{
+				outCommandTimes[i] = commandEndTime - commandStartTime;
+			}
+			commandStartTime = commandEndTime;
+
+			if (timeBudget > 0.0 && commandEndTime - startTime >= timeBudget)
+			{
+				return i + 1;
+			}
+		}
 	}
 	else
 	{
-		QSLOG_ERR("Unable to find Console menu");
+		QSLOG_ERR("Unable to find Console menu, dropped %d commands", (int)numCmds);
+		if (outCommandTimes)
+		{
+			std::fill(outCommandTimes, outCommandTimes + numCmds, 0.0);
+		}
 	}
+
+	return numCmds;
 }
 
 
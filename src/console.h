@@ -3,6 +3,7 @@
 #include "skse64_common/Utilities.h"
 #include "skse64/GameTypes.h"
 #include "skse64/GameMenus.h"
+#include "timer.h"
 
 // Copy of tHashSet class from SKSE - reason for this is we need access to some private members for console code - make SKSEMenuManager a friend class to accomplish this
 // 30
@@ -467,7 +468,11 @@ STATIC_ASSERT(sizeof(SKSEMenuManager) == 0x1C8);
 class CSkyrimConsole
 {
 	static IMenu* sConsoleMenu;
+	static CTimer sTimer;
 public:
 	static void RunCommand(const char* cmd);
+	// menu lookup and call setup done once for all commands.  With timeBudget > 0 stops once timeBudget seconds were spent (after at least one command).
+	// Returns number of commands consumed (commands are dropped if the console is unavailable), outCommandTimes receives the seconds each command took.
+	static size_t RunCommands(const char* const* cmds, size_t numCmds, double timeBudget = 0.0, double* outCommandTimes = nullptr);
 
 };
\ No newline at end of file
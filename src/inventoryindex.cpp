@@ -0,0 +1,109 @@
+/*
+	VRCustomQuickslots - VR Custom Quickslots SKSE extension for SkyrimVR
+	Copyright (C) 2018 L Frazer
+	https://github.com/lfrazer
+
+	This file is part of VRCustomQuickslots.
+
+	VRCustomQuickslots is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	VRCustomQuickslots is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with VRCustomQuickslots.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "inventoryindex.h"
+#include "nativequery.h"
+#include "quickslotutil.h"
+
+void CInventoryIndex::RegisterForEvents()
+{
+	if (mRegistered)
+	{
+		return;
+	}
+
+	EventDispatcherList* dispatcherList = GetEventDispatcherList();
+	if (dispatcherList)
+	{
+		dispatcherList->unk318.AddEventSink(this);  // TESContainerChangedEvent dispatcher
+		mRegistered = true;
+	}
+	else
+	{
+		QSLOG_ERR("Failed to register for container changed events, inventory index disabled (item checks scan the inventory instead)");
+	}
+}
+
+void CInventoryIndex::Invalidate()
+{
+	std::lock_guard<std::mutex> lock(mLock);
+	mValid = false;
+}
+
+SInt32 CInventoryIndex::GetCount(UInt32 formId)
+{
+	std::lock_guard<std::mutex> lock(mLock);
+
+	if (!mValid)
+	{
+		Rebuild();
+	}
+
+	auto it = mCounts.find(formId);
+	return (it != mCounts.end()) ? it->second : 0;
+}
+
+void CInventoryIndex::Rebuild()
+{
+	mCounts.clear();
+
+	// base container plus changes relative to it, this is where almost all of the player inventory lives
+	NativeQuery::VisitInventory((Actor*)(*g_thePlayer), [this](TESForm* form, SInt32 count)
+	{
+		mCounts[form->formID] += count;
+	});
+
+	mValid = true;
+
+	QSLOG_INFO("Rebuilt player inventory index, %d forms", (int)mCounts.size());
+}
+
+EventResult CInventoryIndex::ReceiveEvent(TESContainerChangedEvent* evn, EventDispatcher<TESContainerChangedEvent>* dispatcher)
+{
+	if (!evn || !(*g_thePlayer))
+	{
+		return kEvent_Continue;
+	}
+
+	const UInt32 playerFormId = (*g_thePlayer)->formID;
+	if (evn->fromFormId != playerFormId && evn->toFormId != playerFormId)
+	{
+		return kEvent_Continue;
+	}
+
+	std::lock_guard<std::mutex> lock(mLock);
+
+	// until the first rebuild the index has nothing to update
+	if (mValid)
+	{
+		SInt32& count = mCounts[evn->itemFormId];
+		if (evn->fromFormId == playerFormId)
+		{
+			count -= (SInt32)evn->count;
+		}
+		if (evn->toFormId == playerFormId)
+		{
+			count += (SInt32)evn->count;
+		}
+	}
+
+	return kEvent_Continue;
+}
@@ -0,0 +1,51 @@
+/*
+	VRCustomQuickslots - VR Custom Quickslots SKSE extension for SkyrimVR
+	Copyright (C) 2018 L Frazer
+	https://github.com/lfrazer
+
+	This file is part of VRCustomQuickslots.
+
+	VRCustomQuickslots is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	VRCustomQuickslots is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with VRCustomQuickslots.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "skse64/GameEvents.h"
+#include "skse64/GameForms.h"
+
+#include <mutex>
+#include <unordered_map>
+
+// Player item counts by form ID, so quickslot availability checks are hash lookups instead of Papyrus GetItemCount calls.
+// Built from the player's base container plus ExtraContainerChanges on first use after a load, then kept up to date from TESContainerChangedEvent.
+class CInventoryIndex : public BSTEventSink<TESContainerChangedEvent>
+{
+public:
+	void	RegisterForEvents();  // once, after data is loaded
+	void	Invalidate();  // rebuilt on next lookup (call on load game / new game)
+	bool	IsRegistered() const { return mRegistered; }  // without container events the index would go stale, do not use it then
+
+	SInt32	GetCount(UInt32 formId);  // game thread
+	bool	HasItem(UInt32 formId) { return GetCount(formId) > 0; }
+
+	virtual EventResult	ReceiveEvent(TESContainerChangedEvent* evn, EventDispatcher<TESContainerChangedEvent>* dispatcher);
+
+private:
+	void	Rebuild();
+
+	std::mutex							mLock;  // container events are not guaranteed to come from the game thread
+	std::unordered_map<UInt32, SInt32>	mCounts;
+	bool								mValid = false;
+	bool								mRegistered = false;
+};
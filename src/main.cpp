@@ -25,9 +25,11 @@
 #include "common/IDebugLog.h"
 #include <shlobj.h>				// for use of CSIDL_MYCODUMENTS
 #include <algorithm>
+#include <intrin.h>
 
 #include "quickslots.h"
 #include "quickslotutil.h"
+#include "posesnapshot.h"
 
 
 static PluginHandle					g_pluginHandle = kPluginHandle_Invalid;
@@ -44,6 +46,19 @@ const char* kConfigFile = "Data\\SKSE\\Plugins\\vrcustomquickslots.xml";
 const char* kConfigFileUniqueId = "Data\\SKSE\\Plugins\\vrcustomquickslots_%s.xml";
 const int VRCUSTOMQUICKSLOTS_VERSION = 5;
 
+// Per device input state of OnControllerStateChanged.  The game polls each controller several times per frame, so a call with the same buttons as the
+// previous one in the same pose frame replays the previous output mask instead of running the hit tests again
+struct ControllerInputState
+{
+	uint64_t	lastButtonPressed = 0;	// ulButtonPressed seen by the previous call
+	uint64_t	bindingMask = 0;		// binding button mask the previous call was evaluated with
+	uint64_t	blockMask = 0;			// buttons cleared from the game's state by the previous call
+	uint64_t	analogPressed = 0;		// analog binding bits latched by the previous call (hysteresis)
+	uint32_t	poseSequence = 0;		// pose frame the previous call was evaluated in
+	bool		replayable = false;		// previous call saw no button edge, so its result only depended on buttons and poses
+};
+static ControllerInputState g_inputStates[kMaxInteractionDevices]; // indexed by eInteractionDevice
+
 extern "C" {
 
 	void OnSKSEMessage(SKSEMessagingInterface::Message* msg);
@@ -107,17 +122,24 @@ extern "C" {
 	// Legacy API event handlers
 	void OnVRButtonEvent(PapyrusVR::VREventType type, PapyrusVR::EVRButtonId buttonId, PapyrusVR::VRDevice deviceId)
 	{
+		if (!g_quickslotMgr->BeginHookAccess())  // config is reloading
+		{
+			return;
+		}
+
 		// Use button presses here
 		if (type == PapyrusVR::VREventType_Pressed)
 		{
 			//_MESSAGE("VR Button press deviceId: %d buttonId: %d", deviceId, buttonId);
 
-			g_quickslotMgr->ButtonPress(buttonId, deviceId);
+			g_quickslotMgr->ButtonPress(buttonId, CQuickslotManager::GetInteractionDeviceForVRDevice(deviceId));
 		}
 		else if (type == PapyrusVR::VREventType_Released)
 		{
-			g_quickslotMgr->ButtonRelease(buttonId, deviceId);
+			g_quickslotMgr->ButtonRelease(buttonId, CQuickslotManager::GetInteractionDeviceForVRDevice(deviceId));
 		}
+
+		g_quickslotMgr->EndHookAccess();
 	}
 
 	void OnVRUpdateEvent(float deltaTime)
@@ -127,70 +149,117 @@ extern "C" {
 		PapyrusVR::TrackedDevicePose* rightHandPose = g_papyrusvr->GetVRManager()->GetRightHandPose();
 		PapyrusVR::TrackedDevicePose* hmdPose = g_papyrusvr->GetVRManager()->GetHMDPose();
 
-		g_quickslotMgr->Update(hmdPose, leftHandPose, rightHandPose);
+		if (hmdPose && leftHandPose && rightHandPose)
+		{
+			PoseSnapshot poses;
+			poses.hmd = *hmdPose;
+			poses.devices[kInteractionDevice_LeftHand] = MakeInteractionDevicePose(*leftHandPose);
+			poses.devices[kInteractionDevice_RightHand] = MakeInteractionDevicePose(*rightHandPose);
+			poses.numDevices = kInteractionDevice_FirstTracker;  // legacy API only knows about the two hands
+			poses.timestamp = GetPoseClockTime();
+
+			g_quickslotMgr->Update(poses);
+		}
 
 	}
 
 	// New RAW API event handlers
 	bool OnControllerStateChanged(vr::TrackedDeviceIndex_t unControllerDeviceIndex, const vr::VRControllerState_t* pControllerState, uint32_t unControllerStateSize, vr::VRControllerState_t* pOutputControllerState)
 	{
-		static uint64_t lastButtonPressedData[PapyrusVR::VRDevice_LeftController + 1] = {0}; // should be size 3 array at least for all 3 vr devices
-		static_assert(PapyrusVR::VRDevice_LeftController + 1 >= 3, "lastButtonPressedData array size too small!");
-		
-		if (!g_quickslotMgr->IsTrackingDataValid())
+		if (!g_quickslotMgr->IsTrackingDataValid() || !g_quickslotMgr->BeginHookAccess())  // no access while the config reloads
 		{
 			return false;
 		}
 
-		vr::TrackedDeviceIndex_t leftcontroller = g_VRSystem->GetTrackedDeviceIndexForControllerRole(vr::ETrackedControllerRole::TrackedControllerRole_LeftHand);
-		vr::TrackedDeviceIndex_t rightcontroller = g_VRSystem->GetTrackedDeviceIndexForControllerRole(vr::ETrackedControllerRole::TrackedControllerRole_RightHand);
+		CHookProfiler& profiler = g_quickslotMgr->GetControllerHookProfiler();
+		const double profileStartTime = profiler.Begin();
+
+		g_quickslotMgr->GetPoseTraceRecorder().RecordControllerState(unControllerDeviceIndex, pControllerState);
 
 		// NOTE: DO NOT check the packetNum on ControllerState, it seems to cause problems (maybe it should only be checked per controllers?) - at any rate, it seems to change every frame anyway.  
 
-		PapyrusVR::VRDevice deviceId = PapyrusVR::VRDevice_Unknown;
-			
-		if (unControllerDeviceIndex == leftcontroller)
+		const int device = g_quickslotMgr->FindInteractionDevice(unControllerDeviceIndex);
+
+		if (device < 0)
 		{
-			deviceId = PapyrusVR::VRDevice_LeftController;
+			// input from a device we have not mapped yet (reconnect or role change), refresh mapping on next poses update
+			g_quickslotMgr->ReportUnknownInputDevice(unControllerDeviceIndex);
 		}
-		else if(unControllerDeviceIndex == rightcontroller)
+		else
 		{
-			deviceId = PapyrusVR::VRDevice_RightController;
-		}
+			// all buttons bound in config (activatebutton + <binding> elements), as ulButtonPressed bits
+			const uint64_t bindingMask = g_quickslotMgr->GetBindingMask();
 
-		if (deviceId != PapyrusVR::VRDevice_Unknown)
-		{
-			//We get the activate button from config now so, getting it by function.
-			const auto buttonId = g_quickslotMgr->GetActivateButton();
-			const uint64_t buttonMask = ButtonMaskFromId((vr::EVRButtonId)buttonId);  // annoying issue where PapyrusVR and openvr enums are not type-compatible..
+			ControllerInputState& input = g_inputStates[device];
+			uint64_t buttonPressed = pControllerState->ulButtonPressed;
 
-			// right now only check for trigger press.  In future support input binding?
-			if (pControllerState->ulButtonPressed & buttonMask && !(lastButtonPressedData[deviceId] & buttonMask))
+			// analog bindings replace their click bit with a threshold on the axis value, so activation starts early in the trigger/grip travel
+			const uint64_t analogBindingMask = g_quickslotMgr->GetAnalogBindingMask();
+			if (analogBindingMask)
 			{
-				bool retVal = g_quickslotMgr->ButtonPress(buttonId, deviceId);
+				input.analogPressed = g_quickslotMgr->UpdateAnalogBindings(*pControllerState, input.analogPressed);
+				buttonPressed = (buttonPressed & ~analogBindingMask) | input.analogPressed;
+			}
+			const uint32_t poseSequence = g_quickslotMgr->GetPoseSequence();
+
+			if (input.replayable && buttonPressed == input.lastButtonPressed && bindingMask == input.bindingMask && poseSequence == input.poseSequence && !g_quickslotMgr->UsesPoseExtrapolation())
+			{
+				// duplicate poll: no edges, same hover result as the previous call
+				pOutputControllerState->ulButtonPressed &= ~input.blockMask;
+			}
+			else
+			{
+				uint64_t blockMask = 0;
+
+				// one pass over the bound buttons that changed since the last call, however many bindings there are
+				uint64_t changedButtons = (buttonPressed ^ input.lastButtonPressed) & bindingMask;
+				unsigned long buttonBit = 0;
+
+				while (_BitScanForward64(&buttonBit, changedButtons))
+				{
+					changedButtons &= changedButtons - 1;
+
+					const auto buttonId = (PapyrusVR::EVRButtonId)buttonBit;  // annoying issue where PapyrusVR and openvr enums are not type-compatible..
+					const uint64_t buttonMask = 1ull << buttonBit;
+
+					if (buttonPressed & buttonMask)
+					{
+						bool retVal = g_quickslotMgr->ButtonPress(buttonId, device);
+
+						if (retVal) // mask out input if we touched a quickslot (block the game from receiving it)
+						{
+							blockMask |= buttonMask;
+						}
+
+						QSLOG_INFO("Button %d pressed for deviceIndex: %d device: %d", buttonBit, unControllerDeviceIndex, device);
+					}
+					else
+					{
+						g_quickslotMgr->ButtonRelease(buttonId, device);
 
-				if (retVal) // mask out input if we touched a quickslot (block the game from receiving it)
+						QSLOG_INFO("Button %d released for deviceIndex: %d device: %d", buttonBit, unControllerDeviceIndex, device);
+					}
+				}
+
+				// we need to block all inputs when a bound button is held over top of a quickslot (check last button press and if controller is hovering over a quickslot)
+				const uint64_t heldBindings = input.lastButtonPressed & bindingMask;
+				if (heldBindings && g_quickslotMgr->FindQuickslotByDevice(device))
 				{
-					pOutputControllerState->ulButtonPressed &= ~buttonMask;
+					blockMask |= heldBindings;
 				}
 
-				QSLOG_INFO("Trigger pressed for deviceIndex: %d deviceId: %d", unControllerDeviceIndex, deviceId);
-			}
-			else if (!(pControllerState->ulButtonPressed & buttonMask) && (lastButtonPressedData[deviceId] & buttonMask))
-			{
-				g_quickslotMgr->ButtonRelease(buttonId, deviceId);
+				pOutputControllerState->ulButtonPressed &= ~blockMask;
 
-				QSLOG_INFO("Trigger released for deviceIndex: %d deviceId: %d", unControllerDeviceIndex, deviceId);
-			}
-			
-			// we need to block all inputs when button is held over top of a quickslot (check last button press and if controller is hovering over a quickslot)
-			if (lastButtonPressedData[deviceId] & buttonMask && g_quickslotMgr->FindQuickslotByDeviceId(deviceId))
-			{
-				pOutputControllerState->ulButtonPressed &= ~buttonMask;
+				input.replayable = (buttonPressed == input.lastButtonPressed);
+				input.lastButtonPressed = buttonPressed;
+				input.bindingMask = bindingMask;
+				input.blockMask = blockMask;
+				input.poseSequence = poseSequence;
 			}
-
-			lastButtonPressedData[deviceId] = pControllerState->ulButtonPressed;
 		}
+
+		g_quickslotMgr->EndHookAccess();
+		profiler.End(profileStartTime);
 		
 		return true;
 	}
@@ -199,42 +268,42 @@ extern "C" {
 	vr::EVRCompositorError OnGetPosesUpdate(VR_ARRAY_COUNT(unRenderPoseArrayCount) vr::TrackedDevicePose_t* pRenderPoseArray, uint32_t unRenderPoseArrayCount,
 			VR_ARRAY_COUNT(unGamePoseArrayCount) vr::TrackedDevicePose_t* pGamePoseArray, uint32_t unGamePoseArrayCount)
 	{
-		// actually, we do need to copy the pose memory data here because ButtonPress/Release will refer to it by pointer later.
-		static PapyrusVR::TrackedDevicePose sPoseData[vr::k_unMaxTrackedDeviceCount];
+		// Only the HMD and interaction device poses are copied, not the whole array (base stations and unused trackers are skipped)
+		// Update() publishes the snapshot for the input callbacks, so it can live on the stack here
+		PoseSnapshot poses;
 
-		// NOTE: PapyrusVR tracked pose structure must match structure from OpenVR.h exactly.  Be wary of OpenVR updates!  original code from artumino engineered like this \_(@)_/
-		PapyrusVR::TrackedDevicePose* hmdPose = nullptr;
-		PapyrusVR::TrackedDevicePose* leftCtrlPose = nullptr;
-		PapyrusVR::TrackedDevicePose* rightCtrlPose = nullptr;
+		CHookProfiler& profiler = g_quickslotMgr->GetPosesHookProfiler();
+		const double profileStartTime = profiler.Begin();
 
-		memcpy_s(sPoseData, sizeof(PapyrusVR::TrackedDevicePose) * vr::k_unMaxTrackedDeviceCount, pRenderPoseArray, sizeof(PapyrusVR::TrackedDevicePose) * unRenderPoseArrayCount);
-		
+		g_quickslotMgr->GetPoseTraceRecorder().RecordPoses(pRenderPoseArray, unRenderPoseArrayCount);
 
-		for (uint32_t i = 0; i < unRenderPoseArrayCount; ++i)
-		{
-			if (i == PapyrusVR::k_unTrackedDeviceIndex_Hmd)
-			{
-				hmdPose = (PapyrusVR::TrackedDevicePose*)&sPoseData[i];
-			}
-			else if (i == g_VRSystem->GetTrackedDeviceIndexForControllerRole(vr::ETrackedControllerRole::TrackedControllerRole_LeftHand))
-			{
-				leftCtrlPose = (PapyrusVR::TrackedDevicePose*)&sPoseData[i];
-			}
-			else if (i == g_VRSystem->GetTrackedDeviceIndexForControllerRole(vr::ETrackedControllerRole::TrackedControllerRole_RightHand))
-			{
-				rightCtrlPose = (PapyrusVR::TrackedDevicePose*)&sPoseData[i];
-			}
-		}
+		g_quickslotMgr->UpdateInteractionDevices(pRenderPoseArray, unRenderPoseArrayCount);
+		vr::TrackedDeviceIndex_t deviceIndices[kMaxInteractionDevices];
+		const uint32_t numDevices = g_quickslotMgr->GetInteractionDeviceIndices(deviceIndices);
 
-		// null check to avoid rare crash here
-		if (hmdPose && rightCtrlPose && leftCtrlPose)
+		// skip update if any of the hand poses are missing to avoid rare crash here
+		if (IngestPoses(pRenderPoseArray, unRenderPoseArrayCount, deviceIndices, numDevices, poses))
 		{
-			g_quickslotMgr->Update(hmdPose, leftCtrlPose, rightCtrlPose);
+			g_quickslotMgr->Update(poses);
 		}
 
+		profiler.End(profileStartTime);
+
 		return vr::VRCompositorError_None;
 	}
 
+	// Pose trace replay adapters, the replay drives the RAW API handlers directly instead of the hook manager
+	void ReplayPoses(vr::TrackedDevicePose_t* poseArray, uint32_t poseCount)
+	{
+		OnGetPosesUpdate(poseArray, poseCount, nullptr, 0);
+	}
+
+	void ReplayControllerState(vr::TrackedDeviceIndex_t deviceIndex, const vr::VRControllerState_t* controllerState)
+	{
+		vr::VRControllerState_t outputState = *controllerState;
+		OnControllerStateChanged(deviceIndex, controllerState, sizeof(vr::VRControllerState_t), &outputState);
+	}
+
 	//Listener for PapyrusVR Messages
 	void OnPapyrusVRMessage(SKSEMessagingInterface::Message* msg)
 	{
@@ -264,6 +333,9 @@ extern "C" {
 			}
 			else if (msg->type == SKSEMessagingInterface::kMessage_DataLoaded) //This is needed because we check plugins for items now in ReadConfig function.
 			{
+				// event dispatchers are ready now, the index itself is built on first use after a game is loaded
+				g_quickslotMgr->GetInventoryIndex().RegisterForEvents();
+
 				if (g_papyrusvr)
 				{
 					_MESSAGE("Initializing VRCustomQuickslots data.");
@@ -280,6 +352,18 @@ extern "C" {
 
 						g_quickslotMgr->SetHookMgr(hookMgrAPI);
 						g_VRSystem = hookMgrAPI->GetVRSystem(); // setup VR system before callbacks
+
+						// replay before the hooks are live so the compositor does not call the handlers concurrently.  Input is processed as in game
+						// against a test layout, activations are dispatched but never run any actions.  Nothing the replay left behind reaches the real hooks
+						if (!g_quickslotMgr->GetPoseTraceReplayFile().empty())
+						{
+							g_quickslotMgr->BeginReplay();
+							CPoseTraceReplayer::Replay(g_quickslotMgr->GetPoseTraceReplayFile().c_str(), ReplayPoses, ReplayControllerState);
+							g_quickslotMgr->EndReplay();
+
+							std::fill(std::begin(g_inputStates), std::end(g_inputStates), ControllerInputState());
+						}
+
 						hookMgrAPI->RegisterControllerStateCB(OnControllerStateChanged);
 						hookMgrAPI->RegisterGetPosesCB(OnGetPosesUpdate);
 
@@ -0,0 +1,129 @@
+/*
+	VRCustomQuickslots - VR Custom Quickslots SKSE extension for SkyrimVR
+	Copyright (C) 2018 L Frazer
+	https://github.com/lfrazer
+
+	This file is part of VRCustomQuickslots.
+
+	VRCustomQuickslots is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	VRCustomQuickslots is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with VRCustomQuickslots.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "nativequery.h"
+#include "quickslots.h"
+#include "timer.h"
+
+#include <vector>
+
+namespace NativeQuery
+{
+	SInt32 GetItemCount(Actor* actor, TESForm* item)
+	{
+		SInt32 count = 0;
+		VisitInventory(actor, [item, &count](TESForm* form, SInt32 formCount)
+		{
+			if (form == item)
+			{
+				count += formCount;
+			}
+		});
+
+		return count > 0 ? count : 0;
+	}
+
+	bool HasSpell(Actor* actor, TESForm* spellOrShout)
+	{
+		bool found = false;
+		VisitSpells(actor, [spellOrShout, &found](TESForm* form)
+		{
+			found = found || (form == spellOrShout);
+		});
+
+		return found;
+	}
+
+	bool IsEquipped(Actor* actor, UInt32 formId)
+	{
+		if (!actor)
+		{
+			return false;
+		}
+
+		TESForm* rightEquipped = actor->GetEquippedObject(false);
+		TESForm* leftEquipped = actor->GetEquippedObject(true);
+
+		return (rightEquipped && rightEquipped->formID == formId)
+			|| (leftEquipped && leftEquipped->formID == formId)
+			|| (actor->leftHandSpell && actor->leftHandSpell->formID == formId)
+			|| (actor->rightHandSpell && actor->rightHandSpell->formID == formId)
+			|| (actor->equippedShout && actor->equippedShout->formID == formId);
+	}
+
+	void RunBenchmark(Actor* actor)
+	{
+		const size_t kMaxForms = 256;
+		const size_t kIterations = 16;
+
+		if (!actor)
+		{
+			return;
+		}
+
+		// query forms the actor has plus forms it does not have (its spells for item queries and its items for spell queries),
+		// since most quickslot candidates are misses
+		std::vector<TESForm*> items;
+		std::vector<TESForm*> spells;
+		VisitInventory(actor, [&items](TESForm* form, SInt32) { if (items.size() < kMaxForms) items.push_back(form); });
+		VisitSpells(actor, [&spells](TESForm* form) { if (spells.size() < kMaxForms) spells.push_back(form); });
+
+		std::vector<TESForm*> forms(items);
+		forms.insert(forms.end(), spells.begin(), spells.end());
+		if (forms.empty())
+		{
+			return;
+		}
+
+		VMClassRegistry* registry = (*g_skyrimVM)->GetClassRegistry();
+		CTimer timer;
+		size_t mismatches = 0;
+
+		auto TimeQueries = [&](auto&& query) -> double
+		{
+			const double startTime = timer.GetTime();
+			for (size_t it = 0; it < kIterations; ++it)
+			{
+				for (TESForm* form : forms)
+				{
+					query(form);
+				}
+			}
+			return (timer.GetTime() - startTime) * 1000000.0 / (kIterations * forms.size());
+		};
+
+		volatile SInt32 sink = 0;
+		const double vmItemTime = TimeQueries([&](TESForm* form) { sink = ::GetItemCount(registry, 0, actor, form); });
+		const double nativeItemTime = TimeQueries([&](TESForm* form) { sink = GetItemCount(actor, form); });
+		const double vmSpellTime = TimeQueries([&](TESForm* form) { sink = ::HasSpell(registry, 0, actor, form); });
+		const double nativeSpellTime = TimeQueries([&](TESForm* form) { sink = HasSpell(actor, form); });
+
+		for (TESForm* form : forms)
+		{
+			mismatches += ((::GetItemCount(registry, 0, actor, form) != 0) != (GetItemCount(actor, form) != 0)) ? 1 : 0;
+			mismatches += (::HasSpell(registry, 0, actor, form) != HasSpell(actor, form)) ? 1 : 0;
+		}
+
+		_MESSAGE("Query benchmark %d forms, us per query: GetItemCount vm %.3f native %.3f (%.2fx), HasSpell vm %.3f native %.3f (%.2fx), %d mismatches", (int)forms.size(),
+			vmItemTime, nativeItemTime, nativeItemTime > 0.0 ? vmItemTime / nativeItemTime : 0.0,
+			vmSpellTime, nativeSpellTime, nativeSpellTime > 0.0 ? vmSpellTime / nativeSpellTime : 0.0, (int)mismatches);
+	}
+}
@@ -0,0 +1,123 @@
+/*
+	VRCustomQuickslots - VR Custom Quickslots SKSE extension for SkyrimVR
+	Copyright (C) 2018 L Frazer
+	https://github.com/lfrazer
+
+	This file is part of VRCustomQuickslots.
+
+	VRCustomQuickslots is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	VRCustomQuickslots is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with VRCustomQuickslots.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "skse64/GameReferences.h"
+#include "skse64/GameExtraData.h"
+#include "skse64/GameForms.h"
+#include "skse64/GameRTTI.h"
+
+// Answers the same questions as the Papyrus GetItemCount / HasSpell natives by reading the actor's container, spell lists and equip slots
+// directly, without going through the VM class registry.  Game thread only.
+namespace NativeQuery
+{
+	inline TESNPC* GetActorBase(Actor* actor)
+	{
+		return (actor && actor->baseForm) ? DYNAMIC_CAST(actor->baseForm, TESForm, TESNPC) : nullptr;
+	}
+
+	// visitor(TESForm* item, SInt32 count) for each base container entry (leveled lists skipped, they are resolved into container changes)
+	// and each container change entry.  The same form can be visited twice, counts add up.
+	template <typename TVisitor>
+	void VisitInventory(Actor* actor, TVisitor&& visitor)
+	{
+		TESContainer* container = (actor && actor->baseForm) ? DYNAMIC_CAST(actor->baseForm, TESForm, TESContainer) : nullptr;
+		if (container)
+		{
+			for (UInt32 i = 0; i < container->numEntries; ++i)
+			{
+				TESContainer::Entry* entry = container->entries[i];
+				if (entry && entry->form && entry->form->formType != kFormType_LeveledItem)
+				{
+					visitor(entry->form, (SInt32)entry->count);
+				}
+			}
+		}
+
+		ExtraContainerChanges* containerChanges = actor ? static_cast<ExtraContainerChanges*>(actor->extraData.GetByType(kExtraData_ContainerChanges)) : nullptr;
+		ExtraContainerChanges::Data* containerData = containerChanges ? containerChanges->data : nullptr;
+		if (containerData && containerData->objList)
+		{
+			for (auto it = containerData->objList->Begin(); !it.End(); ++it)
+			{
+				InventoryEntryData* entryData = it.Get();
+				if (entryData && entryData->type)
+				{
+					visitor(entryData->type, entryData->countDelta);
+				}
+			}
+		}
+	}
+
+	// visitor(TESForm* spellOrShout) for the actor's added spells and the spells and shouts of its actor base and race
+	template <typename TVisitor>
+	void VisitSpells(Actor* actor, TVisitor&& visitor)
+	{
+		TESNPC* actorBase = GetActorBase(actor);
+		if (!actorBase)
+		{
+			return;
+		}
+
+		auto VisitSpellList = [&visitor](TESSpellList& spellList)
+		{
+			for (UInt32 i = 0; i < spellList.GetSpellCount(); ++i)
+			{
+				SpellItem* spell = spellList.GetNthSpell(i);
+				if (spell)
+				{
+					visitor(spell);
+				}
+			}
+			for (UInt32 i = 0; i < spellList.GetShoutCount(); ++i)
+			{
+				TESShout* shout = spellList.GetNthShout(i);
+				if (shout)
+				{
+					visitor(shout);
+				}
+			}
+		};
+
+		for (UInt32 i = 0; i < actor->addedSpells.Length(); ++i)
+		{
+			SpellItem* spell = actor->addedSpells.Get(i);
+			if (spell)
+			{
+				visitor(spell);
+			}
+		}
+
+		VisitSpellList(actorBase->spellList);
+		if (actorBase->race.race)
+		{
+			VisitSpellList(actorBase->race.race->spellList);
+		}
+	}
+
+	SInt32	GetItemCount(Actor* actor, TESForm* item);
+	bool	HasSpell(Actor* actor, TESForm* spellOrShout);
+	bool	IsEquipped(Actor* actor, UInt32 formId);  // weapon/item in either hand, spell in either hand or shout
+
+	// log timings of native queries vs the Papyrus natives on the actor's own inventory and spells, and whether results match (debug only)
+	void	RunBenchmark(Actor* actor);
+}
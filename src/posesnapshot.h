@@ -0,0 +1,187 @@
+/*
+	VRCustomQuickslots - VR Custom Quickslots SKSE extension for SkyrimVR
+	Copyright (C) 2018 L Frazer
+	https://github.com/lfrazer
+
+	This file is part of VRCustomQuickslots.
+
+	VRCustomQuickslots is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	VRCustomQuickslots is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with VRCustomQuickslots.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "api/PapyrusVRTypes.h"
+#include "api/OpenVRTypes.h"
+#include "api/openvr.h"
+
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <immintrin.h>
+
+// PapyrusVR tracked pose structure must match structure from OpenVR.h exactly, since we reinterpret the raw hook pose arrays.  Be wary of OpenVR updates!
+static_assert(sizeof(PapyrusVR::TrackedDevicePose) == sizeof(vr::TrackedDevicePose_t), "PapyrusVR::TrackedDevicePose size does not match vr::TrackedDevicePose_t");
+static_assert(offsetof(PapyrusVR::TrackedDevicePose, mDeviceToAbsoluteTracking) == offsetof(vr::TrackedDevicePose_t, mDeviceToAbsoluteTracking), "TrackedDevicePose layout mismatch: mDeviceToAbsoluteTracking");
+static_assert(offsetof(PapyrusVR::TrackedDevicePose, vVelocity) == offsetof(vr::TrackedDevicePose_t, vVelocity), "TrackedDevicePose layout mismatch: vVelocity");
+static_assert(offsetof(PapyrusVR::TrackedDevicePose, vAngularVelocity) == offsetof(vr::TrackedDevicePose_t, vAngularVelocity), "TrackedDevicePose layout mismatch: vAngularVelocity");
+static_assert(offsetof(PapyrusVR::TrackedDevicePose, eTrackingResult) == offsetof(vr::TrackedDevicePose_t, eTrackingResult), "TrackedDevicePose layout mismatch: eTrackingResult");
+static_assert(offsetof(PapyrusVR::TrackedDevicePose, bPoseIsValid) == offsetof(vr::TrackedDevicePose_t, bPoseIsValid), "TrackedDevicePose layout mismatch: bPoseIsValid");
+static_assert(offsetof(PapyrusVR::TrackedDevicePose, bDeviceIsConnected) == offsetof(vr::TrackedDevicePose_t, bDeviceIsConnected), "TrackedDevicePose layout mismatch: bDeviceIsConnected");
+
+// Devices the player can interact with quickslots through.  Both hands always come first, optional generic trackers follow.
+static const uint32_t kMaxInteractionDevices = 8;
+
+enum eInteractionDevice
+{
+	kInteractionDevice_LeftHand = 0,
+	kInteractionDevice_RightHand = 1,
+	kInteractionDevice_FirstTracker = 2,
+};
+
+// The parts of an interaction device pose the plugin uses (overlap position, velocity for pose extrapolation)
+struct InteractionDevicePose
+{
+	PapyrusVR::Vector3	position;
+	PapyrusVR::Vector3	velocity;
+	bool				valid = false;
+};
+
+inline InteractionDevicePose MakeInteractionDevicePose(const PapyrusVR::TrackedDevicePose& pose)
+{
+	InteractionDevicePose devicePose;
+	devicePose.position = PapyrusVR::Vector3(pose.mDeviceToAbsoluteTracking.m[0][3], pose.mDeviceToAbsoluteTracking.m[1][3], pose.mDeviceToAbsoluteTracking.m[2][3]);
+	devicePose.velocity = pose.vVelocity;
+	devicePose.valid = pose.bPoseIsValid;
+	return devicePose;
+}
+
+// Compact copy of only the poses the plugin uses (full HMD pose + position/velocity of the interaction devices), taken from the full render pose
+// array once per frame.  Kept small since the seqlock copies it on every publish and read
+struct alignas(64) PoseSnapshot
+{
+	PapyrusVR::TrackedDevicePose	hmd;
+	InteractionDevicePose			devices[kMaxInteractionDevices];  // indexed by eInteractionDevice, only the first numDevices are used
+	uint32_t						numDevices = 0;
+	double							timestamp = 0.0;  // GetPoseClockTime() when the poses were ingested
+	uint32_t						frameIndex = 0;	  // increasing per published frame, assigned by CQuickslotManager::Update()
+};
+
+// Monotonic high resolution time in seconds, safe to call from any thread (unlike CTimer which caches state)
+inline double GetPoseClockTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Extract HMD and interaction device poses from a raw OpenVR pose array.  Returns false if the HMD or a hand is missing from the array or the hands are not distinct.
+// Trackers that are not in the array are ingested as invalid poses instead, so a lost tracker never stops the update.
+inline bool IngestPoses(const vr::TrackedDevicePose_t* poseArray, uint32_t poseCount, const vr::TrackedDeviceIndex_t* deviceIndices, uint32_t numDevices, PoseSnapshot& outSnapshot)
+{
+	const vr::TrackedDeviceIndex_t leftIndex = deviceIndices[kInteractionDevice_LeftHand];
+	const vr::TrackedDeviceIndex_t rightIndex = deviceIndices[kInteractionDevice_RightHand];
+
+	if (!poseArray || poseCount <= vr::k_unTrackedDeviceIndex_Hmd || numDevices < kInteractionDevice_FirstTracker || numDevices > kMaxInteractionDevices || leftIndex >= poseCount || rightIndex >= poseCount)
+	{
+		return false;
+	}
+
+	if (leftIndex == vr::k_unTrackedDeviceIndex_Hmd || rightIndex == vr::k_unTrackedDeviceIndex_Hmd || leftIndex == rightIndex)
+	{
+		return false;
+	}
+
+	outSnapshot.hmd = reinterpret_cast<const PapyrusVR::TrackedDevicePose&>(poseArray[vr::k_unTrackedDeviceIndex_Hmd]);
+	for (uint32_t i = 0; i < numDevices; ++i)
+	{
+		if (deviceIndices[i] < poseCount)
+		{
+			outSnapshot.devices[i] = MakeInteractionDevicePose(reinterpret_cast<const PapyrusVR::TrackedDevicePose&>(poseArray[deviceIndices[i]]));
+		}
+		else
+		{
+			outSnapshot.devices[i] = InteractionDevicePose();
+		}
+	}
+	outSnapshot.numDevices = numDevices;
+	outSnapshot.timestamp = GetPoseClockTime();
+
+	return true;
+}
+
+// Position of every interaction device in one flat pass over the snapshot.  Devices without a valid pose are placed far outside of any quickslot,
+// so overlap queries can run over all devices without checking validity per device.
+inline void ExtractDevicePositions(const PoseSnapshot& snapshot, PapyrusVR::Vector3* outPositions)
+{
+	const float kInvalidPosition = 1.0e30f;
+
+	for (uint32_t i = 0; i < snapshot.numDevices; ++i)
+	{
+		const PapyrusVR::Vector3& pos = snapshot.devices[i].position;
+		const float valid = snapshot.devices[i].valid ? 0.0f : 1.0f;
+
+		outPositions[i].x = pos.x + valid * kInvalidPosition;
+		outPositions[i].y = pos.y + valid * kInvalidPosition;
+		outPositions[i].z = pos.z + valid * kInvalidPosition;
+	}
+}
+
+// Hands off the latest PoseSnapshot from the poses hook to other threads (controller state hook) without locks.
+// Seqlock with a single writer: Publish() never waits, Read() only retries if it overlapped with a Publish(), so readers never see a torn snapshot.
+class CPoseSnapshotPublisher
+{
+public:
+	void Publish(const PoseSnapshot& snapshot)
+	{
+		const uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+		mSequence.store(sequence + 1, std::memory_order_relaxed);  // odd = write in progress
+		std::atomic_thread_fence(std::memory_order_release);
+
+		mSnapshot = snapshot;
+
+		mSequence.store(sequence + 2, std::memory_order_release);
+	}
+
+	// copy out a consistent snapshot, returns false if nothing has been published yet
+	bool Read(PoseSnapshot& outSnapshot) const
+	{
+		for (;;)
+		{
+			const uint32_t sequenceBefore = mSequence.load(std::memory_order_acquire);
+			if (sequenceBefore & 1)
+			{
+				_mm_pause();
+				continue;
+			}
+
+			outSnapshot = mSnapshot;
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (mSequence.load(std::memory_order_relaxed) == sequenceBefore)
+			{
+				return sequenceBefore != 0;
+			}
+		}
+	}
+
+	bool HasSnapshot() const { return mSequence.load(std::memory_order_acquire) != 0; }
+
+	// drop the published snapshot, only while no other thread publishes or reads (after the startup pose trace replay)
+	void Reset() { mSequence.store(0, std::memory_order_release); }
+
+	// changes whenever a new snapshot is (being) published, cheap way to tell if the poses changed since an earlier call
+	uint32_t GetSequence() const { return mSequence.load(std::memory_order_acquire); }
+
+private:
+	std::atomic<uint32_t>	mSequence = { 0 };
+	PoseSnapshot			mSnapshot;
+};
@@ -0,0 +1,277 @@
+/*
+	VRCustomQuickslots - VR Custom Quickslots SKSE extension for SkyrimVR
+	Copyright (C) 2018 L Frazer
+	https://github.com/lfrazer
+
+	This file is part of VRCustomQuickslots.
+
+	VRCustomQuickslots is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	VRCustomQuickslots is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with VRCustomQuickslots.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "posetrace.h"
+#include "quickslotutil.h"
+
+#include <algorithm>
+
+CPoseTraceRecorder::~CPoseTraceRecorder()
+{
+	Close();
+}
+
+bool CPoseTraceRecorder::Open(const char* filename)
+{
+	Close();
+
+	// the header is written before the file is published, the hooks may already be calling in
+	FILE* file = nullptr;
+	fopen_s(&file, filename, "wb");
+	if (!file)
+	{
+		QSLOG_ERR("Unable to open pose trace file for writing: %s", filename);
+		return false;
+	}
+
+	// large stdio buffer so the hooks only pay for a memcpy most of the time
+	setvbuf(file, nullptr, _IOFBF, 1 << 20);
+
+	PoseTraceHeader header;
+	header.magic = kPoseTraceMagic;
+	header.version = kPoseTraceVersion;
+	header.poseSize = sizeof(vr::TrackedDevicePose_t);
+	header.controllerStateSize = sizeof(vr::VRControllerState_t);
+	fwrite(&header, sizeof(header), 1, file);
+
+	{
+		std::lock_guard<std::mutex> lock(mWriteLock);
+
+		memset(mHasControllerState, 0, sizeof(mHasControllerState));
+		mStartTime = mTimer.GetTime();
+		mFile = file;
+		mOpen.store(true, std::memory_order_relaxed);
+	}
+
+	QSLOG("Recording pose trace to %s", filename);
+
+	return true;
+}
+
+void CPoseTraceRecorder::Close()
+{
+	std::lock_guard<std::mutex> lock(mWriteLock);
+
+	mOpen.store(false, std::memory_order_relaxed);
+	if (mFile)
+	{
+		fclose(mFile);
+		mFile = nullptr;
+	}
+}
+
+void CPoseTraceRecorder::WriteRecord(ePoseTraceRecordType type, uint32_t deviceIndex, uint32_t recordCount, const void* payload, size_t payloadSize)
+{
+	if (!mFile)
+	{
+		return;
+	}
+
+	// header and payload must stay together in the file, which is why the callers hold mWriteLock
+	PoseTraceRecordHeader recordHeader;
+	recordHeader.type = (uint8_t)type;
+	recordHeader.deviceIndex = (uint8_t)deviceIndex;
+	recordHeader.recordCount = (uint16_t)recordCount;
+	recordHeader.time = mTimer.GetTime() - mStartTime;
+
+	fwrite(&recordHeader, sizeof(recordHeader), 1, mFile);
+	fwrite(payload, payloadSize, 1, mFile);
+}
+
+void CPoseTraceRecorder::RecordPoses(const vr::TrackedDevicePose_t* poseArray, uint32_t poseCount)
+{
+	if (!mOpen.load(std::memory_order_relaxed) || !poseArray)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mWriteLock);
+
+	poseCount = std::min<uint32_t>(poseCount, vr::k_unMaxTrackedDeviceCount);
+	WriteRecord(kRecord_Poses, 0, poseCount, poseArray, sizeof(vr::TrackedDevicePose_t) * poseCount);
+}
+
+void CPoseTraceRecorder::RecordControllerState(vr::TrackedDeviceIndex_t deviceIndex, const vr::VRControllerState_t* controllerState)
+{
+	if (!mOpen.load(std::memory_order_relaxed) || !controllerState || deviceIndex >= vr::k_unMaxTrackedDeviceCount)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mWriteLock);
+
+	// only record deltas - the game polls controller state many times per frame
+	if (mHasControllerState[deviceIndex] && memcmp(&mLastControllerState[deviceIndex], controllerState, sizeof(vr::VRControllerState_t)) == 0)
+	{
+		return;
+	}
+
+	mLastControllerState[deviceIndex] = *controllerState;
+	mHasControllerState[deviceIndex] = true;
+
+	WriteRecord(kRecord_ControllerState, deviceIndex, 1, controllerState, sizeof(vr::VRControllerState_t));
+}
+
+
+CHookProfiler::CHookProfiler(const char* name, size_t windowSize)
+	: mName(name), mWindowSize(windowSize)
+{
+	mSamples.reserve(mWindowSize);
+}
+
+double CHookProfiler::Begin()
+{
+	return mEnabled ? mTimer.GetTime() : 0.0;
+}
+
+void CHookProfiler::End(double startTime)
+{
+	if (!mEnabled)
+	{
+		return;
+	}
+
+	AddSample((mTimer.GetTime() - startTime) * 1000000.0);
+}
+
+void CHookProfiler::AddSample(double microseconds)
+{
+	mSamples.push_back((float)microseconds);
+
+	if (mSamples.size() >= mWindowSize)
+	{
+		LogPercentiles();
+		mSamples.clear();
+	}
+}
+
+void CHookProfiler::Flush()
+{
+	if (!mSamples.empty())
+	{
+		LogPercentiles();
+		mSamples.clear();
+	}
+}
+
+void CHookProfiler::LogPercentiles()
+{
+	std::sort(mSamples.begin(), mSamples.end());
+
+	auto Percentile = [this](double p) -> float
+	{
+		const size_t idx = std::min<size_t>(mSamples.size() - 1, (size_t)(p * (double)mSamples.size()));
+		return mSamples[idx];
+	};
+
+	// always written (not filtered by debugloglevel) since profiling is opt-in already
+	_MESSAGE("%s latency over %d calls (us): p50=%.2f p90=%.2f p99=%.2f max=%.2f", mName, (int)mSamples.size(), Percentile(0.5), Percentile(0.9), Percentile(0.99), mSamples.back());
+}
+
+
+bool CPoseTraceReplayer::Replay(const char* filename, PosesHandler posesHandler, ControllerStateHandler controllerStateHandler)
+{
+	FILE* file = nullptr;
+	fopen_s(&file, filename, "rb");
+	if (!file)
+	{
+		QSLOG_ERR("Unable to open pose trace file for replay: %s", filename);
+		return false;
+	}
+
+	setvbuf(file, nullptr, _IOFBF, 1 << 20);
+
+	PoseTraceHeader header;
+	if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != kPoseTraceMagic || header.version != kPoseTraceVersion
+		|| header.poseSize != sizeof(vr::TrackedDevicePose_t) || header.controllerStateSize != sizeof(vr::VRControllerState_t))
+	{
+		QSLOG_ERR("Pose trace %s has an unknown format, not replaying", filename);
+		fclose(file);
+		return false;
+	}
+
+	CHookProfiler frameProfiler("Pose trace replay frame", 1 << 16);
+	frameProfiler.SetEnabled(true);
+
+	CTimer timer;
+	std::vector<vr::TrackedDevicePose_t> poses;
+	vr::VRControllerState_t controllerState;
+	PoseTraceRecordHeader recordHeader;
+	double frameTime = 0.0;
+	bool inFrame = false;
+	size_t numFrames = 0;
+	bool truncated = false;
+
+	while (fread(&recordHeader, sizeof(recordHeader), 1, file) == 1)
+	{
+		if (recordHeader.type == kRecord_Poses)
+		{
+			poses.resize(recordHeader.recordCount);
+			if (recordHeader.recordCount && fread(poses.data(), sizeof(vr::TrackedDevicePose_t), recordHeader.recordCount, file) != recordHeader.recordCount)
+			{
+				truncated = true;
+				break;
+			}
+
+			// a new poses update ends the previous frame
+			if (inFrame)
+			{
+				frameProfiler.AddSample(frameTime * 1000000.0);
+				++numFrames;
+			}
+
+			const double startTime = timer.GetTime();
+			posesHandler(poses.data(), recordHeader.recordCount);
+			frameTime = timer.GetTime() - startTime;
+			inFrame = true;
+		}
+		else if (recordHeader.type == kRecord_ControllerState)
+		{
+			if (fread(&controllerState, sizeof(controllerState), 1, file) != 1)
+			{
+				truncated = true;
+				break;
+			}
+
+			const double startTime = timer.GetTime();
+			controllerStateHandler(recordHeader.deviceIndex, &controllerState);
+			frameTime += timer.GetTime() - startTime;
+		}
+		else
+		{
+			truncated = true;
+			break;
+		}
+	}
+
+	if (inFrame)
+	{
+		frameProfiler.AddSample(frameTime * 1000000.0);
+		++numFrames;
+	}
+	frameProfiler.Flush();
+
+	fclose(file);
+
+	_MESSAGE("Replayed %d frames from pose trace %s%s", (int)numFrames, filename, truncated ? " (trace truncated or corrupt, stopped early)" : "");
+
+	return true;
+}
@@ -0,0 +1,123 @@
+/*
+	VRCustomQuickslots - VR Custom Quickslots SKSE extension for SkyrimVR
+	Copyright (C) 2018 L Frazer
+	https://github.com/lfrazer
+
+	This file is part of VRCustomQuickslots.
+
+	VRCustomQuickslots is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	VRCustomQuickslots is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with VRCustomQuickslots.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "api/openvr.h"
+#include "timer.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Binary pose/input trace written from the RAW OpenVR hooks, so hot path changes can be replayed and measured offline.
+// File layout (little endian, no padding between records):
+//   PoseTraceHeader
+//   repeated { PoseTraceRecordHeader, payload }
+// Payload for kRecord_Poses is recordCount * vr::TrackedDevicePose_t (the raw render pose array)
+// Payload for kRecord_ControllerState is one vr::VRControllerState_t, written only when the state differs from the last one recorded for that device index
+#pragma pack(push, 1)
+struct PoseTraceHeader
+{
+	uint32_t	magic;				// kPoseTraceMagic
+	uint32_t	version;			// kPoseTraceVersion
+	uint32_t	poseSize;			// sizeof(vr::TrackedDevicePose_t) when recorded
+	uint32_t	controllerStateSize;	// sizeof(vr::VRControllerState_t) when recorded
+};
+
+struct PoseTraceRecordHeader
+{
+	uint8_t		type;			// ePoseTraceRecordType
+	uint8_t		deviceIndex;	// tracked device index for controller state records, 0 for poses
+	uint16_t	recordCount;	// number of poses in payload, 1 for controller state
+	double		time;			// seconds since the recorder was opened
+};
+#pragma pack(pop)
+
+enum ePoseTraceRecordType
+{
+	kRecord_Poses = 1,
+	kRecord_ControllerState = 2,
+};
+
+static const uint32_t kPoseTraceMagic = 0x52545351; // "QSTR"
+static const uint32_t kPoseTraceVersion = 1;
+
+class CPoseTraceRecorder
+{
+public:
+	~CPoseTraceRecorder();
+
+	bool	Open(const char* filename);
+	void	Close();
+	bool	IsOpen() const { return mOpen.load(std::memory_order_relaxed); }
+
+	void	RecordPoses(const vr::TrackedDevicePose_t* poseArray, uint32_t poseCount);
+	void	RecordControllerState(vr::TrackedDeviceIndex_t deviceIndex, const vr::VRControllerState_t* controllerState);
+
+private:
+	void	WriteRecord(ePoseTraceRecordType type, uint32_t deviceIndex, uint32_t recordCount, const void* payload, size_t payloadSize);  // caller holds mWriteLock
+
+	std::mutex				mWriteLock;  // poses (compositor thread) and controller states (input thread) are recorded concurrently, everything below is guarded by it
+	std::atomic<bool>		mOpen = false;  // lets the hooks skip the lock while nothing is recorded
+	FILE*					mFile = nullptr;
+	CTimer					mTimer;
+	double					mStartTime = 0.0;
+	vr::VRControllerState_t	mLastControllerState[vr::k_unMaxTrackedDeviceCount] = {};  // last state written per device, used to only record deltas
+	bool					mHasControllerState[vr::k_unMaxTrackedDeviceCount] = {};
+};
+
+// Measures time spent inside a hook callback and periodically logs latency percentiles
+class CHookProfiler
+{
+public:
+	CHookProfiler(const char* name, size_t windowSize = 2048);
+
+	void	SetEnabled(bool flag) { mEnabled = flag; }
+	bool	IsEnabled() const { return mEnabled; }
+
+	double	Begin();  // returns start time to pass into End()
+	void	End(double startTime);
+	void	AddSample(double microseconds);  // for durations measured by the caller
+	void	Flush();  // log the samples of the current (partial) window
+
+private:
+	void	LogPercentiles();
+
+	const char*				mName;
+	CTimer					mTimer;
+	std::vector<float>		mSamples;  // durations in microseconds for current window
+	size_t					mWindowSize;
+	bool					mEnabled = false;
+};
+
+// Feeds a recorded trace back through the RAW API hook handlers, as if the compositor and input hooks called them, and logs per-frame
+// latency percentiles.  A frame is one poses record plus the controller state records up to the next poses record, only handler time is counted.
+class CPoseTraceReplayer
+{
+public:
+	typedef void(*PosesHandler)(vr::TrackedDevicePose_t* poseArray, uint32_t poseCount);
+	typedef void(*ControllerStateHandler)(vr::TrackedDeviceIndex_t deviceIndex, const vr::VRControllerState_t* controllerState);
+
+	static bool	Replay(const char* filename, PosesHandler posesHandler, ControllerStateHandler controllerStateHandler);
+};
@@ -0,0 +1,624 @@
+/*
+	VRCustomQuickslots - VR Custom Quickslots SKSE extension for SkyrimVR
+	Copyright (C) 2018 L Frazer
+	https://github.com/lfrazer
+
+	This file is part of VRCustomQuickslots.
+
+	VRCustomQuickslots is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	VRCustomQuickslots is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with VRCustomQuickslots.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "quickslotgeometry.h"
+#include "quickslotutil.h"
+#include "timer.h"
+
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <intrin.h>
+#include <immintrin.h>
+
+void CQuickslotGrid::Clear()
+{
+	mDims[0] = mDims[1] = mDims[2] = 0;
+	mCellStart.clear();
+	mCellSlots.clear();
+}
+
+void CQuickslotGrid::Build(const float* xs, const float* ys, const float* zs, const float* hitRadiusSqr, size_t count)
+{
+	const size_t kMaxCells = 64 * 1024;
+
+	Clear();
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	// bounds of all hit spheres and largest sphere radius
+	float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	float maxRadius = 0.0f;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float radius = sqrtf(std::max<float>(hitRadiusSqr[i], 0.0f));
+		const float center[3] = { xs[i], ys[i], zs[i] };
+
+		if (!std::isfinite(radius) || !std::isfinite(center[0]) || !std::isfinite(center[1]) || !std::isfinite(center[2]))
+		{
+			QSLOG_ERR("Quickslot %d has a non-finite position or radius, not building the quickslot grid", (int)i);
+			Clear();
+			return;
+		}
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			boundsMin[axis] = std::min<float>(boundsMin[axis], center[axis] - radius);
+			boundsMax[axis] = std::max<float>(boundsMax[axis], center[axis] + radius);
+		}
+		maxRadius = std::max<float>(maxRadius, radius);
+	}
+
+	// extents can still overflow for huge (finite) positions
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		if (!std::isfinite(boundsMax[axis] - boundsMin[axis]))
+		{
+			QSLOG_ERR("Quickslot layout is too large, not building the quickslot grid");
+			Clear();
+			return;
+		}
+	}
+
+	// cell size = largest sphere diameter, grown if a very spread out layout would need too many cells.
+	// Cell counts are computed in double, so a large layout can not overflow the int dimensions before the cells are grown
+	float cellSize = std::max<float>(2.0f * maxRadius, 0.001f);
+	size_t numCells = 0;
+
+	for (;;)
+	{
+		double dims[3];
+		double cellCount = 1.0;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			dims[axis] = floor((double)(boundsMax[axis] - boundsMin[axis]) / cellSize) + 1.0;
+			cellCount *= dims[axis];
+		}
+
+		if (cellCount <= (double)kMaxCells)
+		{
+			numCells = 1;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				mDims[axis] = (int)dims[axis];
+				numCells *= (size_t)mDims[axis];
+			}
+			break;
+		}
+
+		cellSize *= 2.0f;
+	}
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		mMin[axis] = boundsMin[axis];
+	}
+	mInvCellSize = 1.0f / cellSize;
+
+	// two passes over the slots: count entries per cell, then fill.  Slots are visited in order so every cell list stays sorted.
+	mCellStart.assign(numCells + 1, 0);
+
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		std::vector<uint32_t> cellFill;
+		if (pass == 1)
+		{
+			for (size_t c = 0; c < numCells; ++c)
+			{
+				mCellStart[c + 1] += mCellStart[c];
+			}
+			mCellSlots.resize(mCellStart[numCells]);
+			cellFill.assign(mCellStart.begin(), mCellStart.end() - 1);
+		}
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float radius = sqrtf(std::max<float>(hitRadiusSqr[i], 0.0f));
+
+			const int x0 = CellCoord(xs[i] - radius, 0), x1 = CellCoord(xs[i] + radius, 0);
+			const int y0 = CellCoord(ys[i] - radius, 1), y1 = CellCoord(ys[i] + radius, 1);
+			const int z0 = CellCoord(zs[i] - radius, 2), z1 = CellCoord(zs[i] + radius, 2);
+
+			for (int z = z0; z <= z1; ++z)
+			{
+				for (int y = y0; y <= y1; ++y)
+				{
+					for (int x = x0; x <= x1; ++x)
+					{
+						const size_t cell = ((size_t)z * mDims[1] + y) * mDims[0] + x;
+						if (pass == 0)
+						{
+							++mCellStart[cell + 1];
+						}
+						else
+						{
+							mCellSlots[cellFill[cell]++] = (uint32_t)i;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+int CQuickslotGrid::CellCoord(float value, int axis) const
+{
+	const int coord = (int)((value - mMin[axis]) * mInvCellSize);
+	return std::min<int>(std::max<int>(coord, 0), mDims[axis] - 1);
+}
+
+const uint32_t* CQuickslotGrid::GetCandidates(const PapyrusVR::Vector3& pos, size_t& outCount) const
+{
+	outCount = 0;
+
+	const float coords[3] = { (pos.x - mMin[0]) * mInvCellSize, (pos.y - mMin[1]) * mInvCellSize, (pos.z - mMin[2]) * mInvCellSize };
+	int cellCoords[3];
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		// outside of the bounds of every hit sphere, nothing to test
+		if (!(coords[axis] >= 0.0f && coords[axis] < (float)mDims[axis]))
+		{
+			return nullptr;
+		}
+		cellCoords[axis] = (int)coords[axis];
+	}
+
+	const size_t cell = ((size_t)cellCoords[2] * mDims[1] + cellCoords[1]) * mDims[0] + cellCoords[0];
+	outCount = mCellStart[cell + 1] - mCellStart[cell];
+
+	return mCellSlots.data() + mCellStart[cell];
+}
+
+
+void CQuickslotGeometry::Clear()
+{
+	mCount = 0;
+	mOriginX.clear();
+	mOriginY.clear();
+	mOriginZ.clear();
+	mWorldX.clear();
+	mWorldY.clear();
+	mWorldZ.clear();
+	mRadius.clear();
+	mHitRadiusSqr.clear();
+	mGrid.Clear();
+}
+
+void CQuickslotGeometry::AddSlot(const PapyrusVR::Vector3& origin, float radius)
+{
+	// drop padding from a previous Finalize() before appending
+	mOriginX.resize(mCount);
+	mOriginY.resize(mCount);
+	mOriginZ.resize(mCount);
+	mRadius.resize(mCount);
+
+	mOriginX.push_back(origin.x);
+	mOriginY.push_back(origin.y);
+	mOriginZ.push_back(origin.z);
+	mRadius.push_back(radius);
+
+	++mCount;
+}
+
+void CQuickslotGeometry::Finalize(float controllerRadius)
+{
+	const size_t paddedSize = ((mCount + kGeometryPadding - 1) / kGeometryPadding) * kGeometryPadding;
+
+	mOriginX.resize(paddedSize, 0.0f);
+	mOriginY.resize(paddedSize, 0.0f);
+	mOriginZ.resize(paddedSize, 0.0f);
+	mRadius.resize(paddedSize, 0.0f);
+
+	// world positions start out equal to the origins until the first frame transforms them
+	mWorldX = mOriginX;
+	mWorldY = mOriginY;
+	mWorldZ = mOriginZ;
+
+	mHitRadiusSqr.resize(paddedSize);
+	for (size_t i = 0; i < paddedSize; ++i)
+	{
+		const float combinedRadius = controllerRadius + mRadius[i];
+		mHitRadiusSqr[i] = (i < mCount) ? combinedRadius * combinedRadius : -1.0f;  // padding never overlaps
+	}
+
+	// origins never change after config load, so the grid only has to be rebuilt here
+	if (mCount >= kGridMinSlots)
+	{
+		mGrid.Build(mOriginX.data(), mOriginY.data(), mOriginZ.data(), mHitRadiusSqr.data(), mCount);
+	}
+	else
+	{
+		mGrid.Clear();
+	}
+}
+
+bool CQuickslotGeometry::Overlaps(const PapyrusVR::Vector3& pos, const float* xs, const float* ys, const float* zs, size_t i, float* outDistSqr) const
+{
+	const float dx = pos.x - xs[i];
+	const float dy = pos.y - ys[i];
+	const float dz = pos.z - zs[i];
+	const float distSqr = dx * dx + dy * dy + dz * dz;
+
+	if (outDistSqr)
+	{
+		*outDistSqr = distSqr;
+	}
+
+	return distSqr < mHitRadiusSqr[i];
+}
+
+void CQuickslotGeometry::UpdateWorldPositions(const PapyrusVR::Matrix33& rotMatrix, const PapyrusVR::Vector3& hmdPos)
+{
+	// same as MultMatrix33() + translation, written out over the arrays
+	const float m00 = rotMatrix.m[0][0], m01 = rotMatrix.m[0][1], m02 = rotMatrix.m[0][2];
+	const float m10 = rotMatrix.m[1][0], m11 = rotMatrix.m[1][1], m12 = rotMatrix.m[1][2];
+	const float m20 = rotMatrix.m[2][0], m21 = rotMatrix.m[2][1], m22 = rotMatrix.m[2][2];
+
+	for (size_t i = 0; i < mCount; ++i)
+	{
+		const float ox = mOriginX[i];
+		const float oy = mOriginY[i];
+		const float oz = mOriginZ[i];
+
+		mWorldX[i] = m00 * ox + m01 * oy + m02 * oz + hmdPos.x;
+		mWorldY[i] = m10 * ox + m11 * oy + m12 * oz + hmdPos.y;
+		mWorldZ[i] = m20 * ox + m21 * oy + m22 * oz + hmdPos.z;
+	}
+}
+
+int CQuickslotGeometry::FindFirstOverlap(const PapyrusVR::Vector3& pos, bool localFrame) const
+{
+	const float* xs = X(localFrame);
+	const float* ys = Y(localFrame);
+	const float* zs = Z(localFrame);
+
+	if (localFrame && mGrid.IsBuilt())
+	{
+		// candidates are in ascending order, so the first overlap is the same one the linear scan would find
+		size_t numCandidates = 0;
+		const uint32_t* candidates = mGrid.GetCandidates(pos, numCandidates);
+
+		for (size_t c = 0; c < numCandidates; ++c)
+		{
+			if (Overlaps(pos, xs, ys, zs, candidates[c]))
+			{
+				return (int)candidates[c];
+			}
+		}
+
+		return -1;
+	}
+
+	for (size_t i = 0; i < mCount; ++i)
+	{
+		if (Overlaps(pos, xs, ys, zs, i))
+		{
+			return (int)i;  // this quickslot is overlapping
+		}
+	}
+
+	return -1;
+}
+
+int CQuickslotGeometry::FindNearest(const PapyrusVR::Vector3& pos, bool localFrame, float* outDistSqr) const
+{
+	const float* xs = X(localFrame);
+	const float* ys = Y(localFrame);
+	const float* zs = Z(localFrame);
+
+	float closestDistSqr = FLT_MAX;
+	int closestIndex = -1;
+
+	for (size_t i = 0; i < mCount; ++i)
+	{
+		const float dx = pos.x - xs[i];
+		const float dy = pos.y - ys[i];
+		const float dz = pos.z - zs[i];
+		const float currDistSqr = dx * dx + dy * dy + dz * dz;
+
+		if (currDistSqr < closestDistSqr)
+		{
+			closestDistSqr = currDistSqr;
+			closestIndex = (int)i;
+		}
+	}
+
+	if (outDistSqr)
+	{
+		*outDistSqr = closestDistSqr;
+	}
+
+	return closestIndex;
+}
+
+void CQuickslotGeometry::BeginBatch(size_t numPoints, QuickslotOverlapBatch& outBatch) const
+{
+	const size_t numMaskWords = (PaddedSize() + 63) / 64;
+
+	outBatch.numPoints = std::min<size_t>(numPoints, QuickslotOverlapBatch::kMaxPoints);
+	for (size_t p = 0; p < outBatch.numPoints; ++p)
+	{
+		outBatch.overlapMask[p].assign(numMaskWords, 0);
+		outBatch.firstHit[p] = -1;
+		outBatch.nearestHit[p] = -1;
+	}
+}
+
+// pick first and nearest hit from the overlap masks, only touches the (few) overlapping entries
+void CQuickslotGeometry::ResolveBatchHits(const PapyrusVR::Vector3* points, bool localFrame, QuickslotOverlapBatch& outBatch) const
+{
+	const float* xs = X(localFrame);
+	const float* ys = Y(localFrame);
+	const float* zs = Z(localFrame);
+
+	for (size_t p = 0; p < outBatch.numPoints; ++p)
+	{
+		float closestDistSqr = FLT_MAX;
+		const std::vector<uint64_t>& mask = outBatch.overlapMask[p];
+
+		for (size_t word = 0; word < mask.size(); ++word)
+		{
+			uint64_t bits = mask[word];
+			unsigned long bit = 0;
+
+			while (_BitScanForward64(&bit, bits))
+			{
+				bits &= bits - 1;
+
+				const int i = (int)(word * 64 + bit);
+				const float dx = points[p].x - xs[i];
+				const float dy = points[p].y - ys[i];
+				const float dz = points[p].z - zs[i];
+				const float currDistSqr = dx * dx + dy * dy + dz * dz;
+
+				if (outBatch.firstHit[p] < 0)
+				{
+					outBatch.firstHit[p] = i;
+				}
+
+				if (currDistSqr < closestDistSqr)
+				{
+					closestDistSqr = currDistSqr;
+					outBatch.nearestHit[p] = i;
+				}
+			}
+		}
+	}
+}
+
+void CQuickslotGeometry::FindOverlapsScalar(const PapyrusVR::Vector3* points, size_t numPoints, bool localFrame, QuickslotOverlapBatch& outBatch) const
+{
+	BeginBatch(numPoints, outBatch);
+
+	const float* xs = X(localFrame);
+	const float* ys = Y(localFrame);
+	const float* zs = Z(localFrame);
+	const float* hitRadiusSqr = mHitRadiusSqr.data();
+
+	for (size_t i = 0; i < mCount; ++i)
+	{
+		for (size_t p = 0; p < outBatch.numPoints; ++p)
+		{
+			const float dx = points[p].x - xs[i];
+			const float dy = points[p].y - ys[i];
+			const float dz = points[p].z - zs[i];
+
+			if (dx * dx + dy * dy + dz * dz < hitRadiusSqr[i])
+			{
+				outBatch.overlapMask[p][i >> 6] |= 1ull << (i & 63);
+			}
+		}
+	}
+
+	ResolveBatchHits(points, localFrame, outBatch);
+}
+
+void CQuickslotGeometry::FindOverlapsGrid(const PapyrusVR::Vector3* points, size_t numPoints, QuickslotOverlapBatch& outBatch) const
+{
+	BeginBatch(numPoints, outBatch);
+
+	const float* xs = X(true);
+	const float* ys = Y(true);
+	const float* zs = Z(true);
+
+	for (size_t p = 0; p < outBatch.numPoints; ++p)
+	{
+		size_t numCandidates = 0;
+		const uint32_t* candidates = mGrid.GetCandidates(points[p], numCandidates);
+		float closestDistSqr = FLT_MAX;
+
+		for (size_t c = 0; c < numCandidates; ++c)
+		{
+			const uint32_t i = candidates[c];
+			float currDistSqr = 0.0f;
+
+			if (Overlaps(points[p], xs, ys, zs, i, &currDistSqr))
+			{
+				outBatch.overlapMask[p][i >> 6] |= 1ull << (i & 63);
+
+				if (outBatch.firstHit[p] < 0)
+				{
+					outBatch.firstHit[p] = (int)i;  // candidates are ascending
+				}
+
+				if (currDistSqr < closestDistSqr)
+				{
+					closestDistSqr = currDistSqr;
+					outBatch.nearestHit[p] = (int)i;
+				}
+			}
+		}
+	}
+}
+
+void CQuickslotGeometry::FindOverlaps(const PapyrusVR::Vector3* points, size_t numPoints, bool localFrame, QuickslotOverlapBatch& outBatch) const
+{
+	if (localFrame && mGrid.IsBuilt())
+	{
+		FindOverlapsGrid(points, numPoints, outBatch);
+		return;
+	}
+
+#if defined(__AVX__) || defined(_M_X64) || defined(__SSE2__)
+	BeginBatch(numPoints, outBatch);
+
+	const float* xs = X(localFrame);
+	const float* ys = Y(localFrame);
+	const float* zs = Z(localFrame);
+	const float* hitRadiusSqr = mHitRadiusSqr.data();
+	const size_t paddedSize = PaddedSize();  // padding entries have a negative hit radius, so no tail loop is needed
+	const size_t numPointsInBatch = outBatch.numPoints;
+
+#if defined(__AVX__)
+	const size_t kLanes = 8;
+	__m256 px[QuickslotOverlapBatch::kMaxPoints], py[QuickslotOverlapBatch::kMaxPoints], pz[QuickslotOverlapBatch::kMaxPoints];
+	for (size_t p = 0; p < numPointsInBatch; ++p)
+	{
+		px[p] = _mm256_set1_ps(points[p].x);
+		py[p] = _mm256_set1_ps(points[p].y);
+		pz[p] = _mm256_set1_ps(points[p].z);
+	}
+
+	for (size_t i = 0; i < paddedSize; i += kLanes)
+	{
+		// load each slot block once and test it against every point
+		const __m256 x = _mm256_loadu_ps(xs + i);
+		const __m256 y = _mm256_loadu_ps(ys + i);
+		const __m256 z = _mm256_loadu_ps(zs + i);
+		const __m256 r2 = _mm256_loadu_ps(hitRadiusSqr + i);
+
+		for (size_t p = 0; p < numPointsInBatch; ++p)
+		{
+			const __m256 dx = _mm256_sub_ps(px[p], x);
+			const __m256 dy = _mm256_sub_ps(py[p], y);
+			const __m256 dz = _mm256_sub_ps(pz[p], z);
+			const __m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+			const uint64_t bits = (uint64_t)_mm256_movemask_ps(_mm256_cmp_ps(d2, r2, _CMP_LT_OQ));
+
+			outBatch.overlapMask[p][i >> 6] |= bits << (i & 63);
+		}
+	}
+#else
+	const size_t kLanes = 4;
+	__m128 px[QuickslotOverlapBatch::kMaxPoints], py[QuickslotOverlapBatch::kMaxPoints], pz[QuickslotOverlapBatch::kMaxPoints];
+	for (size_t p = 0; p < numPointsInBatch; ++p)
+	{
+		px[p] = _mm_set1_ps(points[p].x);
+		py[p] = _mm_set1_ps(points[p].y);
+		pz[p] = _mm_set1_ps(points[p].z);
+	}
+
+	for (size_t i = 0; i < paddedSize; i += kLanes)
+	{
+		// load each slot block once and test it against every point
+		const __m128 x = _mm_loadu_ps(xs + i);
+		const __m128 y = _mm_loadu_ps(ys + i);
+		const __m128 z = _mm_loadu_ps(zs + i);
+		const __m128 r2 = _mm_loadu_ps(hitRadiusSqr + i);
+
+		for (size_t p = 0; p < numPointsInBatch; ++p)
+		{
+			const __m128 dx = _mm_sub_ps(px[p], x);
+			const __m128 dy = _mm_sub_ps(py[p], y);
+			const __m128 dz = _mm_sub_ps(pz[p], z);
+			const __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+			const uint64_t bits = (uint64_t)_mm_movemask_ps(_mm_cmplt_ps(d2, r2));
+
+			outBatch.overlapMask[p][i >> 6] |= bits << (i & 63);
+		}
+	}
+#endif
+
+	ResolveBatchHits(points, localFrame, outBatch);
+#else
+	FindOverlapsScalar(points, numPoints, localFrame, outBatch);
+#endif
+}
+
+void CQuickslotGeometry::RunBenchmark()
+{
+	const size_t kTableSizes[] = { 8, 64, 1024 };
+	const size_t kSlotTestsPerRun = 4 * 1024 * 1024;  // roughly the same amount of work for each table size
+	const size_t kNumPoints = 2;  // both hands
+
+	CTimer timer;
+	uint32_t seed = 12345;
+	auto Random = [&seed](float range) -> float
+	{
+		seed = seed * 1664525 + 1013904223;  // simple LCG, so every run uses the same layout
+		return ((float)(seed >> 8) / (float)(1 << 24) - 0.5f) * range;
+	};
+
+	for (size_t tableSize : kTableSizes)
+	{
+		CQuickslotGeometry geometry;
+		for (size_t i = 0; i < tableSize; ++i)
+		{
+			geometry.AddSlot(PapyrusVR::Vector3(Random(1.5f), Random(1.5f), Random(1.5f)), 0.1f);
+		}
+		geometry.Finalize(0.1f);
+
+		const PapyrusVR::Vector3 points[kNumPoints] = { PapyrusVR::Vector3(-0.2f, 0.1f, 0.3f), PapyrusVR::Vector3(0.25f, -0.1f, 0.3f) };
+		const size_t iterations = kSlotTestsPerRun / tableSize;
+
+		// world positions equal the origins until UpdateWorldPositions() is called, so the world frame query runs the linear
+		// SIMD kernel and the local frame query the grid (if the table is large enough to have one) over the same layout
+		auto TimeQueries = [&](bool useScalar, bool localFrame, QuickslotOverlapBatch& batch) -> double
+		{
+			const double startTime = timer.GetTime();
+			for (size_t it = 0; it < iterations; ++it)
+			{
+				if (useScalar)
+				{
+					geometry.FindOverlapsScalar(points, kNumPoints, localFrame, batch);
+				}
+				else
+				{
+					geometry.FindOverlaps(points, kNumPoints, localFrame, batch);
+				}
+			}
+			return (timer.GetTime() - startTime) * 1000000.0 / iterations;
+		};
+
+		QuickslotOverlapBatch scalarBatch, simdBatch, gridBatch;
+		const double scalarTime = TimeQueries(true, false, scalarBatch);
+		const double simdTime = TimeQueries(false, false, simdBatch);
+		const double gridTime = TimeQueries(false, true, gridBatch);
+
+		bool match = true;
+		for (size_t p = 0; p < kNumPoints; ++p)
+		{
+			match = match && scalarBatch.overlapMask[p] == simdBatch.overlapMask[p] && scalarBatch.overlapMask[p] == gridBatch.overlapMask[p]
+				&& scalarBatch.firstHit[p] == simdBatch.firstHit[p] && scalarBatch.firstHit[p] == gridBatch.firstHit[p]
+				&& scalarBatch.nearestHit[p] == simdBatch.nearestHit[p] && scalarBatch.nearestHit[p] == gridBatch.nearestHit[p];
+		}
+
+		_MESSAGE("Overlap benchmark %d slots x %d points, us per query: scalar %.3f, simd %.3f (%.2fx), %s %.3f (%.2fx)%s", (int)tableSize, (int)kNumPoints,
+			scalarTime, simdTime, simdTime > 0.0 ? scalarTime / simdTime : 0.0, geometry.HasGrid() ? "grid" : "local simd", gridTime, gridTime > 0.0 ? scalarTime / gridTime : 0.0,
+			match ? "" : " RESULT MISMATCH");
+	}
+}
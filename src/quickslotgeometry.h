@@ -0,0 +1,128 @@
+/*
+	VRCustomQuickslots - VR Custom Quickslots SKSE extension for SkyrimVR
+	Copyright (C) 2018 L Frazer
+	https://github.com/lfrazer
+
+	This file is part of VRCustomQuickslots.
+
+	VRCustomQuickslots is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	VRCustomQuickslots is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with VRCustomQuickslots.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "api/PapyrusVRTypes.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Output of CQuickslotGeometry::FindOverlaps(), reused between frames so the query does not allocate
+struct QuickslotOverlapBatch
+{
+	static const size_t kMaxPoints = 8;
+
+	size_t					numPoints = 0;
+	std::vector<uint64_t>	overlapMask[kMaxPoints];	// bit (i & 63) of word (i >> 6) is set when slot i overlaps point
+	int						firstHit[kMaxPoints];		// lowest overlapping slot index (same result as FindFirstOverlap), -1 if none
+	int						nearestHit[kMaxPoints];		// overlapping slot with the closest center, -1 if none
+};
+
+// Uniform grid over the slot hit spheres in the HMD local frame, so point queries only test the few slots near the point.
+// Cells are sized to the largest hit sphere (each sphere touches at most 2x2x2 cells), slot lists are stored CSR style in ascending slot order.
+class CQuickslotGrid
+{
+public:
+	void	Clear();
+	void	Build(const float* xs, const float* ys, const float* zs, const float* hitRadiusSqr, size_t count);
+	bool	IsBuilt() const { return !mCellStart.empty(); }
+
+	// slot indices (ascending) whose hit sphere may contain pos, nullptr / 0 if pos is outside of the grid
+	const uint32_t*	GetCandidates(const PapyrusVR::Vector3& pos, size_t& outCount) const;
+
+private:
+	int		CellCoord(float value, int axis) const;
+
+	float					mMin[3] = { 0.0f, 0.0f, 0.0f };
+	float					mInvCellSize = 0.0f;
+	int						mDims[3] = { 0, 0, 0 };
+	std::vector<uint32_t>	mCellStart;		// cell c owns mCellSlots[mCellStart[c] .. mCellStart[c+1])
+	std::vector<uint32_t>	mCellSlots;
+};
+
+// Packed structure-of-arrays copy of the quickslot geometry used by overlap queries, kept apart from the (large) quickslot command data
+// so hover and press lookups only stream the few floats they need.  Entry i always belongs to quickslot i of CQuickslotManager.
+// Arrays are padded up to a multiple of kGeometryPadding with entries that can never overlap, so batch kernels need no tail handling.
+class CQuickslotGeometry
+{
+public:
+	static const size_t kGeometryPadding = 8;
+	static const size_t kGridMinSlots = 32;	// below this a linear SIMD scan beats the grid lookup
+
+	void	Clear();
+	void	AddSlot(const PapyrusVR::Vector3& origin, float radius);
+	void	Finalize(float controllerRadius);  // call after all slots were added, precomputes hit radius, padding and the grid for large layouts
+
+	// legacy mode: rotate/translate all origins into world (tracking) space for this frame
+	void	UpdateWorldPositions(const PapyrusVR::Matrix33& rotMatrix, const PapyrusVR::Vector3& hmdPos);
+
+	// index of the first slot overlapping a controller sphere at pos (world or HMD local frame), -1 if none
+	int		FindFirstOverlap(const PapyrusVR::Vector3& pos, bool localFrame) const;
+	// index of the slot whose center is closest to pos, -1 if there are no slots
+	int		FindNearest(const PapyrusVR::Vector3& pos, bool localFrame, float* outDistSqr = nullptr) const;
+
+	// does the controller sphere at pos overlap slot i (single slot test, e.g. to check if a hovered slot is still hovered)
+	bool	OverlapsSlot(const PapyrusVR::Vector3& pos, bool localFrame, size_t i) const { return i < mCount && Overlaps(pos, X(localFrame), Y(localFrame), Z(localFrame), i); }
+
+	// test up to QuickslotOverlapBatch::kMaxPoints controller spheres against all slots in a single pass over the table (SSE, or AVX when compiled with /arch:AVX)
+	void	FindOverlaps(const PapyrusVR::Vector3* points, size_t numPoints, bool localFrame, QuickslotOverlapBatch& outBatch) const;
+	// reference implementation of FindOverlaps() without SIMD, used as fallback and to validate the kernels
+	void	FindOverlapsScalar(const PapyrusVR::Vector3* points, size_t numPoints, bool localFrame, QuickslotOverlapBatch& outBatch) const;
+
+	// log timings of scalar vs SIMD overlap queries at a few table sizes (debug only)
+	static void	RunBenchmark();
+
+	size_t	Size() const { return mCount; }
+	bool	HasGrid() const { return mGrid.IsBuilt(); }  // local frame queries go through the grid instead of scanning every slot
+	size_t	PaddedSize() const { return mHitRadiusSqr.size(); }
+
+	const float*	X(bool localFrame) const { return localFrame ? mOriginX.data() : mWorldX.data(); }
+	const float*	Y(bool localFrame) const { return localFrame ? mOriginY.data() : mWorldY.data(); }
+	const float*	Z(bool localFrame) const { return localFrame ? mOriginZ.data() : mWorldZ.data(); }
+	const float*	HitRadiusSqr() const { return mHitRadiusSqr.data(); }
+
+	PapyrusVR::Vector3	GetWorldPosition(size_t i) const { return PapyrusVR::Vector3(mWorldX[i], mWorldY[i], mWorldZ[i]); }
+
+private:
+	void	BeginBatch(size_t numPoints, QuickslotOverlapBatch& outBatch) const;
+	void	ResolveBatchHits(const PapyrusVR::Vector3* points, bool localFrame, QuickslotOverlapBatch& outBatch) const;
+	void	FindOverlapsGrid(const PapyrusVR::Vector3* points, size_t numPoints, QuickslotOverlapBatch& outBatch) const;
+	bool	Overlaps(const PapyrusVR::Vector3& pos, const float* xs, const float* ys, const float* zs, size_t i, float* outDistSqr = nullptr) const;
+
+	size_t				mCount = 0;
+
+	// quickslot origins in HMD yaw-local frame (never change after config load)
+	std::vector<float>	mOriginX;
+	std::vector<float>	mOriginY;
+	std::vector<float>	mOriginZ;
+
+	// origins transformed into world space, updated every frame in legacy mode
+	std::vector<float>	mWorldX;
+	std::vector<float>	mWorldY;
+	std::vector<float>	mWorldZ;
+
+	std::vector<float>	mRadius;		// slot radius (only needed to rebuild hit radius)
+	std::vector<float>	mHitRadiusSqr;	// (controller radius + slot radius)^2, negative for padding entries
+
+	CQuickslotGrid		mGrid;			// over the origins, only built for layouts with at least kGridMinSlots slots
+};
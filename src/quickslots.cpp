@@ -22,8 +22,10 @@
 #include "quickslots.h"
 #include "quickslotutil.h"
 #include "console.h"
+#include "nativequery.h"
 #include "api/openvr.h"
 #include <algorithm>
+#include <cstring>
 
 #include "MenuChecker.h"
 
@@ -44,7 +46,23 @@ RelocAddr <_DropObject> DropObject(0x09CE580);
 
 
 CQuickslotManager::CQuickslotManager()
+	: mPosesHookProfiler("OnGetPosesUpdate"), mControllerHookProfiler("OnControllerStateChanged")
 {
+	for (auto& deviceIndex : mInteractionDeviceIndex)
+	{
+		deviceIndex.store(vr::k_unTrackedDeviceIndexInvalid, std::memory_order_relaxed);
+	}
+	for (auto& device : mTrackedDeviceToInteraction)
+	{
+		device.store(-1, std::memory_order_relaxed);
+	}
+	for (auto& task : mActionTaskPool)
+	{
+		task.mPooled = true;
+		task.mNextFree = mFreeActionTasks;
+		mFreeActionTasks = &task;
+	}
+
 	MenuManager * mm = MenuManager::GetSingleton();
 	if (mm) {
 		mm->MenuOpenCloseEventDispatcher()->AddEventSink(&MenuChecker::menuEvent);
@@ -76,116 +94,515 @@ void  CQuickslotManager::GetVRSystem()
 	}
 }
 
+void	CQuickslotManager::RefreshInteractionDevices()
+{
+	vr::TrackedDeviceIndex_t deviceIndices[kMaxInteractionDevices];
+	uint32_t numDevices = kInteractionDevice_FirstTracker;
+
+	deviceIndices[kInteractionDevice_LeftHand] = mVRSystem->GetTrackedDeviceIndexForControllerRole(vr::TrackedControllerRole_LeftHand);
+	deviceIndices[kInteractionDevice_RightHand] = mVRSystem->GetTrackedDeviceIndexForControllerRole(vr::TrackedControllerRole_RightHand);
+
+	if (mUseTrackers)
+	{
+		for (vr::TrackedDeviceIndex_t i = 0; i < vr::k_unMaxTrackedDeviceCount && numDevices < kMaxInteractionDevices; ++i)
+		{
+			// the runtime keeps reporting the class of trackers that were switched off, those would be mapped and lost again every frame
+			if (mVRSystem->GetTrackedDeviceClass(i) == vr::TrackedDeviceClass_GenericTracker && mVRSystem->IsTrackedDeviceConnected(i))
+			{
+				deviceIndices[numDevices++] = i;
+			}
+		}
+	}
+
+	// unmap old device indices first, so devices swapping indices (left/right role swap) do not unmap each other
+	for (uint32_t device = 0; device < kMaxInteractionDevices; ++device)
+	{
+		const vr::TrackedDeviceIndex_t deviceIndex = (device < numDevices) ? deviceIndices[device] : vr::k_unTrackedDeviceIndexInvalid;
+		const vr::TrackedDeviceIndex_t lastDeviceIndex = mInteractionDeviceIndex[device].load(std::memory_order_relaxed);
+
+		if (deviceIndex != lastDeviceIndex && lastDeviceIndex < vr::k_unMaxTrackedDeviceCount)
+		{
+			mTrackedDeviceToInteraction[lastDeviceIndex].store(-1, std::memory_order_relaxed);
+		}
+	}
+
+	for (uint32_t device = 0; device < kMaxInteractionDevices; ++device)
+	{
+		const vr::TrackedDeviceIndex_t deviceIndex = (device < numDevices) ? deviceIndices[device] : vr::k_unTrackedDeviceIndexInvalid;
+
+		if (deviceIndex != mInteractionDeviceIndex[device].load(std::memory_order_relaxed))
+		{
+			QSLOG_INFO("Interaction device %d mapped to device index %d", device, deviceIndex);
+			mInteractionDeviceIndex[device].store(deviceIndex, std::memory_order_relaxed);
+		}
+
+		if (deviceIndex < vr::k_unMaxTrackedDeviceCount)
+		{
+			mTrackedDeviceToInteraction[deviceIndex].store((int)device, std::memory_order_relaxed);
+		}
+	}
+
+	// devices that sent input and are still not mapped do not trigger refreshes again, devices mapped now are allowed again should they get unmapped.
+	// Role changes of rejected devices are still picked up by the periodic refresh
+	uint64_t mappedDevices = 0;
+	for (uint32_t device = 0; device < numDevices; ++device)
+	{
+		mappedDevices |= (deviceIndices[device] < vr::k_unMaxTrackedDeviceCount) ? (1ull << deviceIndices[device]) : 0;
+	}
+	const uint64_t unknownDevices = mUnknownInputDevices.exchange(0, std::memory_order_relaxed);
+	mRejectedInputDevices.store((mRejectedInputDevices.load(std::memory_order_relaxed) | unknownDevices) & ~mappedDevices, std::memory_order_relaxed);
+
+	mNumInteractionDevices.store(numDevices, std::memory_order_relaxed);
+	mInteractionDevicesDirty.store(false, std::memory_order_relaxed);
+	mLastInteractionDeviceRefreshTime = CUtil::GetSingleton().GetLastTime();
+}
+
+// Only ask the runtime for the device mapping when a cached device disappears from the pose array, an unknown device sends input,
+// or (as a fallback for role swaps, since the hook API does not forward VREvent_TrackedDeviceRoleChanged) every few seconds
+void	CQuickslotManager::UpdateInteractionDevices(const vr::TrackedDevicePose_t* poseArray, uint32_t poseCount)
+{
+	const double kDirtyRefreshInterval = 0.25;
+	const double kPeriodicRefreshInterval = 2.0;
+
+	if (!mVRSystem)
+	{
+		return;
+	}
+
+	// only a lost hand needs an immediate refresh, a tracker that disconnects just reports invalid poses until the periodic refresh drops it
+	bool mappingLost = false;
+	for (uint32_t device = 0; device < kInteractionDevice_FirstTracker; ++device)
+	{
+		const vr::TrackedDeviceIndex_t deviceIndex = GetInteractionDeviceIndex(device);
+		mappingLost |= (deviceIndex >= poseCount || !poseArray[deviceIndex].bDeviceIsConnected);
+	}
+
+	const double timeSinceRefresh = CUtil::GetSingleton().GetLastTime() - mLastInteractionDeviceRefreshTime;
+	const bool dirty = mInteractionDevicesDirty.load(std::memory_order_relaxed);
+
+	if (mappingLost || mLastInteractionDeviceRefreshTime < 0.0 || (dirty && timeSinceRefresh > kDirtyRefreshInterval) || timeSinceRefresh > kPeriodicRefreshInterval)
+	{
+		RefreshInteractionDevices();
+	}
+}
+
+uint32_t	CQuickslotManager::GetInteractionDeviceIndices(vr::TrackedDeviceIndex_t* outDeviceIndices) const
+{
+	for (uint32_t device = 0; device < kMaxInteractionDevices; ++device)
+	{
+		outDeviceIndices[device] = GetInteractionDeviceIndex(device);
+	}
+
+	return mNumInteractionDevices.load(std::memory_order_relaxed);
+}
+
 // make sure all pointers for tracking data are valid - error checking
 bool	CQuickslotManager::IsTrackingDataValid() const
 {
-	return (this && mHMDPose && mRightControllerPose && mLeftControllerPose);
+	return (this && mPosePublisher.HasSnapshot());
 }
 
-void	CQuickslotManager::UpdateHaptics()
+void	CQuickslotManager::UpdateHaptics(uint32_t numDevices)
 {
 	const unsigned short kVRHapticConstant = 2000;  // max value is 3999 but ue4 suggest max 2000? - time in microseconds to pulse per frame, also described by Valve as "strength"
 
-	if (mVRSystem)
+	if (mVRSystem && !mReplaying)  // replayed hovers must not buzz the real controllers
 	{
-		for (int i = 0; i < 2; ++i)
+		for (uint32_t i = 0; i < numDevices; ++i)
 		{
-			if (mControllerHapticTime[i] > CUtil::GetSingleton().GetLastTime())
+			if (mDeviceHapticTime[i] > CUtil::GetSingleton().GetLastTime())
 			{
-				// haptic remaining times are indexed in array by (ETrackedControllerRole enum value - 1) - so add 1 to loop index i to get the correct value - see StartHaptics()
-				auto controllerId = mVRSystem->GetTrackedDeviceIndexForControllerRole( (vr::ETrackedControllerRole)(i + 1) );
-				mVRSystem->TriggerHapticPulse(controllerId, 0, kVRHapticConstant);
+				vr::TrackedDeviceIndex_t deviceIndex = GetInteractionDeviceIndex(i);
+
+				// the mapping cache is only filled by the RAW poses hook, the legacy PapyrusVR path still asks the runtime for the hands
+				if (deviceIndex == vr::k_unTrackedDeviceIndexInvalid && i < kInteractionDevice_FirstTracker)
+				{
+					deviceIndex = mVRSystem->GetTrackedDeviceIndexForControllerRole((i == kInteractionDevice_LeftHand) ? vr::TrackedControllerRole_LeftHand : vr::TrackedControllerRole_RightHand);
+				}
+
+				if (deviceIndex != vr::k_unTrackedDeviceIndexInvalid)
+				{
+					mVRSystem->TriggerHapticPulse(deviceIndex, 0, kVRHapticConstant);
+				}
 			}
 		}
 	}
 }
 
-void	CQuickslotManager::StartHaptics(vr::ETrackedControllerRole controller, double timeLength)
+void	CQuickslotManager::StartHaptics(int device, double timeLength)
+{
+	mDeviceHapticTime[device] = CUtil::GetSingleton().GetLastTime() + timeLength;
+
+	QSLOG_INFO("Started haptic feedback for %f seconds on device %d", timeLength, device);
+}
+
+template <typename TQueue>
+void	CQuickslotManager::QueueEvent(TQueue& queue, eQuickslotEventType type, int device, int button, int slotIndex)
+{
+	QuickslotEvent event;
+	event.mType = (uint8_t)type;
+	event.mDevice = (int8_t)device;
+	event.mButton = (int16_t)button;
+	event.mSlotIndex = slotIndex;
+
+	if (!queue.Push(event))
+	{
+		QSLOG_ERR("Quickslot event queue full, dropped event type %d on slot %d", type, slotIndex);
+		return;
+	}
+
+	// one dispatch task per batch of events, not per event
+	if (!mDispatchScheduled.exchange(true, std::memory_order_acq_rel))
+	{
+		static taskDispatchQuickslotEvents sDispatchTask;
+		g_task->AddTask(&sDispatchTask);
+	}
+}
+
+void	CQuickslotManager::DispatchEvents()
+{
+	// clear the flag before draining: events pushed from now on schedule a new task, events pushed before are seen by the loops below
+	mDispatchScheduled.exchange(false, std::memory_order_acq_rel);
+
+	QuickslotEvent event;
+	while (mInputEvents.Pop(event) || mFrameEvents.Pop(event))
+	{
+		CQuickslot* quickslot = GetQuickslotByIndex(event.mSlotIndex);
+		if (!quickslot || !mInGame)  // also drops activations of a pose trace replay
+		{
+			continue;
+		}
+
+		if (event.mType == kQuickslotEvent_Release)
+		{
+			RunQuickslotCommands(quickslot, event.mDevice, event.mButton);
+		}
+		else if (event.mType == kQuickslotEvent_LongPress)
+		{
+			EditQuickslot(quickslot, event.mDevice);
+		}
+	}
+
+	// one task insertion for everything the events above decided to do
+	if (mPendingActions && mPendingActions->HasActions())
+	{
+		g_task->AddTask(mPendingActions);
+		mPendingActions = nullptr;
+	}
+}
+
+void	CQuickslotManager::QueueAction(const QuickslotAction& action)
+{
+	if (!mPendingActions)
+	{
+		if (mFreeActionTasks)
+		{
+			mPendingActions = mFreeActionTasks;
+			mFreeActionTasks = mFreeActionTasks->mNextFree;
+		}
+		else
+		{
+			// more batches in flight than the pool holds (game thread stalled?), still run the actions
+			mPendingActions = new taskQuickslotActions();
+			++mActionTaskOverflows;
+			QSLOG_ERR("Quickslot action task pool exhausted, %d overflow allocations so far", mActionTaskOverflows);
+		}
+	}
+
+	mPendingActions->AddAction() = action;
+}
+
+void	CQuickslotManager::ReleaseActionTask(taskQuickslotActions* task)
+{
+	task->ClearActions();
+
+	if (task->mPooled)
+	{
+		task->mNextFree = mFreeActionTasks;
+		mFreeActionTasks = task;
+	}
+	else
+	{
+		delete task;
+	}
+}
+
+void	CQuickslotManager::QueueConsoleCommands(const std::shared_ptr<const ConsoleCommandList>& commands, uint32_t first, uint32_t count)
+{
+	if (!commands || count == 0)
+	{
+		return;
+	}
+
+	if (mConsoleQueueHead == mConsoleQueue.size())
+	{
+		// everything before ran already, start over so the queue keeps its buffer
+		mConsoleQueue.clear();
+		mConsoleQueueHead = 0;
+	}
+
+	QueuedConsoleCommands queued;
+	queued.mCommands = commands;
+	queued.mFirst = first;
+	queued.mCount = count;
+	mConsoleQueue.push_back(queued);
+}
+
+void	CQuickslotManager::RunConsoleQueue(bool ignoreBudget)
+{
+	// the budget is shared by every run in the same frame (action batches and the queue task)
+	const uint32_t poseSequence = GetPoseSequence();
+	if (poseSequence != mConsoleBudgetSequence)
+	{
+		mConsoleBudgetSequence = poseSequence;
+		mConsoleBudgetUsed = 0.0;
+	}
+
+	const bool useBudget = mConsoleFrameBudget > 0.0 && !ignoreBudget;
+	const bool budgetLeft = !useBudget || mConsoleBudgetUsed < mConsoleFrameBudget;
+
+	mConsoleBatch.clear();
+	for (size_t i = mConsoleQueueHead; budgetLeft && i < mConsoleQueue.size(); ++i)
+	{
+		const QueuedConsoleCommands& queued = mConsoleQueue[i];
+		for (uint32_t c = 0; c < queued.mCount; ++c)
+		{
+			mConsoleBatch.push_back((*queued.mCommands)[queued.mFirst + c].c_str());
+		}
+	}
+
+	if (!mConsoleBatch.empty())
+	{
+		mConsoleCommandTimes.resize(mConsoleBatch.size());
+		const double budget = useBudget ? mConsoleFrameBudget - mConsoleBudgetUsed : 0.0;
+		size_t numRun = CSkyrimConsole::RunCommands(mConsoleBatch.data(), mConsoleBatch.size(), budget, mConsoleCommandTimes.data());
+
+		for (size_t i = 0; i < numRun; ++i)
+		{
+			mConsoleBudgetUsed += mConsoleCommandTimes[i];
+			mMaxConsoleCommandTime = std::max<double>(mMaxConsoleCommandTime, mConsoleCommandTimes[i]);
+			QSLOG_INFO("Console command took %.3f ms (max %.3f ms): %s", mConsoleCommandTimes[i] * 1000.0, mMaxConsoleCommandTime * 1000.0, mConsoleBatch[i]);
+		}
+
+		// pop what ran, a partly run entry keeps its remaining commands
+		while (numRun > 0)
+		{
+			QueuedConsoleCommands& queued = mConsoleQueue[mConsoleQueueHead];
+			const uint32_t numFromEntry = (uint32_t)std::min<size_t>(numRun, queued.mCount);
+
+			queued.mFirst += numFromEntry;
+			queued.mCount -= numFromEntry;
+			numRun -= numFromEntry;
+
+			if (queued.mCount == 0)
+			{
+				queued.mCommands.reset();
+				++mConsoleQueueHead;
+			}
+		}
+	}
+
+	// rest runs in later frames, ProcessFrame schedules taskRunConsoleQueue once per frame while commands are waiting
+	mConsoleQueuePending.store(mConsoleQueueHead < mConsoleQueue.size(), std::memory_order_release);
+	mConsoleTaskScheduled.store(false, std::memory_order_release);
+}
+
+void	CQuickslotManager::EditQuickslot(CQuickslot* quickslot, int device)
+{
+	// Empty slot if it is bound to an action, otherwise modify it (also special case for non-default orders to check "mOtherCommands")
+	if ( (quickslot->mOrder == CQuickslot::DEFAULT && quickslot->mCommand.mAction != CQuickslot::NO_ACTION)
+		|| (quickslot->mOtherCommands.size() > 0 && quickslot->mOtherCommands[0].mAction != CQuickslot::NO_ACTION) )
+	{
+		StartHaptics(device, 0.5); // haptics on un-equip slot
+		quickslot->UnsetAction();
+	}
+	else // modify the quickslot with current item/spell if none is set
+	{
+		StartHaptics(device, 1.0); // longer haptics on equip
+		quickslot->SetAction(GetHandForDevice(device));
+	}
+}
+
+void	CQuickslotManager::Update(const PoseSnapshot& inPoses)
+{
+	PoseSnapshot poses = inPoses;
+	poses.frameIndex = ++mFrameIndex;
+
+	mPosePublisher.Publish(poses);
+
+	// in worker thread mode the hook only publishes poses, everything else runs on the worker.  The frame is announced before checking the flag
+	// (seq_cst on both sides), so StartWorkerThread() either sees this frame and waits for it or this frame sees the worker
+	mInlineFrameCount.fetch_add(1, std::memory_order_seq_cst);
+	if (mWorkerThreadActive.load(std::memory_order_seq_cst))
+	{
+		mInlineFrameCount.fetch_sub(1, std::memory_order_release);
+		SetEvent(mWorkerThreadEvent);
+		return;
+	}
+
+	if (BeginHookAccess())
+	{
+		ProcessFrame(poses);
+		EndHookAccess();
+	}
+	mInlineFrameCount.fetch_sub(1, std::memory_order_release);
+}
+
+bool	CQuickslotManager::BeginHookAccess()
+{
+	// announce the access before checking the flag (seq_cst on both sides), so BeginReload() either sees this hook or the hook sees the reload
+	mHookAccessCount.fetch_add(1, std::memory_order_seq_cst);
+	if (mReloading.load(std::memory_order_seq_cst))
+	{
+		mHookAccessCount.fetch_sub(1, std::memory_order_release);
+		return false;
+	}
+
+	return true;
+}
+
+void	CQuickslotManager::BeginReload()
+{
+	mReloading.store(true, std::memory_order_seq_cst);
+
+	// hook calls that got in before the flag are short (one frame or one controller poll)
+	while (mHookAccessCount.load(std::memory_order_seq_cst) != 0)
+	{
+		std::this_thread::yield();
+	}
+}
+
+void	CQuickslotManager::StartWorkerThread(int cpuCore)
+{
+	if (mWorkerThread.joinable())
+	{
+		return;
+	}
+
+	// event is created once and kept for the lifetime of the plugin, so a hook racing with StopWorkerThread() never signals a closed handle
+	if (!mWorkerThreadEvent)
+	{
+		mWorkerThreadEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);  // auto-reset, multiple signals before the worker wakes up collapse into one frame
+		if (!mWorkerThreadEvent)
+		{
+			QSLOG_ERR("Failed to create worker thread event, error: %d", GetLastError());
+			return;
+		}
+	}
+
+	// a hook may have signalled the event while the previous worker was joined, that stale frame must not wake the new worker
+	ResetEvent(mWorkerThreadEvent);
+
+	// hooks stop processing inline from here, the worker only starts once the last inline frame is done so ProcessFrame never runs twice at once
+	mWorkerThreadActive.store(true, std::memory_order_seq_cst);
+	while (mInlineFrameCount.load(std::memory_order_seq_cst) != 0)
+	{
+		std::this_thread::yield();
+	}
+
+	mWorkerThreadQuit.store(false);
+	mWorkerThread = std::thread(&CQuickslotManager::WorkerThreadMain, this);
+
+	if (cpuCore >= 0 && cpuCore < 64)
+	{
+		if (!SetThreadAffinityMask(mWorkerThread.native_handle(), 1ULL << cpuCore))
+		{
+			QSLOG_ERR("Failed to pin worker thread to core %d, error: %d", cpuCore, GetLastError());
+		}
+	}
+
+	QSLOG("Started quickslot worker thread (core %d)", cpuCore);
+}
+
+void	CQuickslotManager::StopWorkerThread()
 {
-	mControllerHapticTime[controller - 1] = CUtil::GetSingleton().GetLastTime() + timeLength;
+	if (!mWorkerThread.joinable())
+	{
+		return;
+	}
+
+	// wait for the worker to finish its current frame before the hooks go back to updating inline
+	mWorkerThreadQuit.store(true);
+	SetEvent(mWorkerThreadEvent);
+	mWorkerThread.join();
+
+	mWorkerThreadActive.store(false, std::memory_order_release);
 
-	QSLOG_INFO("Started haptic feedback for %f seconds on controller %d", timeLength, controller);
+	QSLOG("Stopped quickslot worker thread");
 }
 
-void	CQuickslotManager::Update(PapyrusVR::TrackedDevicePose* hmdPose, PapyrusVR::TrackedDevicePose* leftCtrlPose, PapyrusVR::TrackedDevicePose* rightCtrlPose)
+void	CQuickslotManager::WorkerThreadMain()
 {
-	mHMDPose = hmdPose;
-	mLeftControllerPose = leftCtrlPose;
-	mRightControllerPose = rightCtrlPose;
+	PoseSnapshot poses;
 
+	while (WaitForSingleObject(mWorkerThreadEvent, INFINITE) == WAIT_OBJECT_0 && !mWorkerThreadQuit.load())
+	{
+		// always process the latest poses, if the worker fell behind intermediate frames are skipped
+		if (mPosePublisher.Read(poses))
+		{
+			ProcessFrame(poses);
+		}
+	}
+}
+
+void	CQuickslotManager::ProcessFrame(const PoseSnapshot& poses)
+{
 	CUtil::GetSingleton().Update();
-	UpdateHaptics();
+	UpdateHaptics(poses.numDevices);
 
-	if (mInGame && !MenuChecker::isGameStopped() && hmdPose->bPoseIsValid && leftCtrlPose->bPoseIsValid && rightCtrlPose->bPoseIsValid)
+	// console commands over last frame's budget continue on the game thread, one task per frame
+	if (mConsoleQueuePending.load(std::memory_order_acquire) && !mConsoleTaskScheduled.exchange(true, std::memory_order_acq_rel))
 	{
-		PapyrusVR::Vector3 hmdPos = GetPositionFromVRPose(mHMDPose);
-		PapyrusVR::Matrix33 rotMatrix = CreateRotMatrixAroundY(mHMDPose->mDeviceToAbsoluteTracking);
+		static taskRunConsoleQueue sConsoleQueueTask;
+		g_task->AddTask(&sConsoleQueueTask);
+	}
 
-		for (auto it = mQuickslotArray.begin(); it != mQuickslotArray.end(); ++it)
+	// devices without a valid pose never hover anything (see ExtractDevicePositions), so only the HMD is required here
+	if (IsProcessingInput() && poses.hmd.bPoseIsValid)
+	{
+		// in HMD local query mode the quickslots stay in their origin frame and the controllers are moved into it instead (see FindQuickslotAtControllerPos)
+		if (!mHMDLocalQuery)
 		{
-			// update quickslots based on HMD rotation
-			it->mPosition = MultMatrix33(rotMatrix, it->mOrigin);
+			PapyrusVR::Vector3 hmdPos = GetPositionFromVRPose(&poses.hmd);
+			PapyrusVR::Matrix33 rotMatrix = CreateRotMatrixAroundY(poses.hmd.mDeviceToAbsoluteTracking);
 
-			// update translation for each quickslot 
-			it->mPosition = it->mPosition + hmdPos;
+			// update quickslots based on HMD rotation and translation
+			mQuickslotGeometry.UpdateWorldPositions(rotMatrix, hmdPos);
 		}
 
-		// Check for overlaps for haptic feedback
+		// find hovered quickslot for each device once per frame (enter/exit haptics are triggered from here)
+		UpdateHoverStates(poses);
+
+		// long press handling and haptic feedback
 		if (mHapticOnOverlap && mVRSystem)
 		{
-			// setup array of controllers and loop through it
-			const double kHapticTimeout = 1.0;
-			const int numControllers = 2;
-			PapyrusVR::TrackedDevicePose* controllers[numControllers] = {mLeftControllerPose, mRightControllerPose};
-			const vr::ETrackedControllerRole controllerRoles[numControllers] = { vr::ETrackedControllerRole::TrackedControllerRole_LeftHand, vr::ETrackedControllerRole::TrackedControllerRole_RightHand };
-			const PapyrusVR::VRDevice controllerDeviceIds[numControllers] = { PapyrusVR::VRDevice::VRDevice_LeftController, PapyrusVR::VRDevice::VRDevice_RightController };
-
-			for (int i = 0; i < numControllers; ++i)
+			for (int i = 0; i < (int)poses.numDevices; ++i)
 			{
-				PapyrusVR::Vector3 controllerPos = GetPositionFromVRPose(controllers[i]);
-				CQuickslot* quickslot = FindQuickslot(controllerPos, mControllerRadius);
+				CQuickslot* quickslot = GetQuickslotByIndex(mHoverState[i].mSlotIndex);
 
 				if (quickslot)
 				{
-					// Do haptic response (but not constantly, check for timeout)
-					if (mHoverQuickslotHapticTime > 0.0 && CUtil::GetSingleton().GetLastTime() - quickslot->mLastOverlapTime > kHapticTimeout)
-					{						
-						StartHaptics(controllerRoles[i], mHoverQuickslotHapticTime);						
-					}
-
 					quickslot->mLastOverlapTime = CUtil::GetSingleton().GetLastTime();
 
-					// trigger constant haptics on long press to indicate long press to the user
+					// trigger constant haptics on long press to indicate long press to the user (only for bindings that allow long press)
 					const double currButtonHeldTime = CUtil::GetSingleton().GetLastTime() - quickslot->mButtonHoldTime;
-					if (quickslot->mButtonHoldTime > 0.0 &&  currButtonHeldTime > mShortPressTime)
+					const bool longPressAllowed = IsLongPressButton(quickslot->mHoldButton);
+					if (longPressAllowed && quickslot->mButtonHoldTime > 0.0 &&  currButtonHeldTime > mShortPressTime)
 					{
 						if (std::fmod(currButtonHeldTime, 0.5) < 0.05)
 						{
-							StartHaptics(controllerRoles[i], 0.075);
+							StartHaptics(i, 0.075);
 						}
 					}
 
-					if (quickslot->mButtonHoldTime > 0.0 && currButtonHeldTime > mLongPressTime)
+					if (longPressAllowed && quickslot->mButtonHoldTime > 0.0 && currButtonHeldTime > mLongPressTime)
 					{
 						QSLOG_INFO("Hold button action on quickslot %s !", quickslot->mName.c_str());
 
-						// on long press, unset the quickslot action so the user can modify it later
+						// on long press, unset the quickslot action so the user can modify it later (reads the equipped item, so done on the game thread)
 						if (mAllowEditSlots)
 						{
-							// trigger haptic response
-
-							// Empty slot if it is bound to an action, otherwise modify it (also special case for non-default orders to check "mOtherCommands")
-							if ( (quickslot->mOrder == CQuickslot::DEFAULT && quickslot->mCommand.mAction != CQuickslot::NO_ACTION)
-								|| (quickslot->mOtherCommands.size() > 0 && quickslot->mOtherCommands[0].mAction != CQuickslot::NO_ACTION) )
-							{
-								StartHaptics(controllerRoles[i], 0.5); // haptics on un-equip slot
-								quickslot->UnsetAction();
-							}
-							else // modify the quickslot with current item/spell if none is set
-							{
-								StartHaptics(controllerRoles[i], 1.0); // longer haptics on equip
-								quickslot->SetAction(controllerDeviceIds[i]);
-							}
+							QueueEvent(mFrameEvents, kQuickslotEvent_LongPress, i, quickslot->mHoldButton, mHoverState[i].mSlotIndex);
 
 							quickslot->mButtonHoldTime = -1.0;
 						}
@@ -201,56 +618,177 @@ void	CQuickslotManager::Update(PapyrusVR::TrackedDevicePose* hmdPose, PapyrusVR:
 			GetVRSystem();
 		}
 	}
+	else
+	{
+		// nothing is hovered while in menus or without tracking.  Frame index 0 never matches a published frame, so input hooks fall back to their own query
+		for (int i = 0; i < (int)kMaxInteractionDevices; ++i)
+		{
+			SetHoverSlot(i, -1, 0);
+		}
+	}
+}
+
+// position used for overlap queries: the controller position itself, or moved into the quickslot origin frame in HMD local query mode
+PapyrusVR::Vector3	CQuickslotManager::GetQueryPosition(const PapyrusVR::TrackedDevicePose& hmdPose, const PapyrusVR::Vector3& controllerPos) const
+{
+	return mHMDLocalQuery ? WorldToHMDYawLocal(hmdPose.mDeviceToAbsoluteTracking, controllerPos) : controllerPos;
 }
 
-CQuickslot*	CQuickslotManager::FindQuickslotByDeviceId(PapyrusVR::VRDevice deviceId)
+void	CQuickslotManager::UpdateHoverStates(const PoseSnapshot& poses)
 {
-	// find quickslot based on current hand 
-	PapyrusVR::TrackedDevicePose* currControllerPose = nullptr;
+	const int numDevices = (int)poses.numDevices;
+	const bool localFrame = mHMDLocalQuery != 0;
 
-	if (deviceId == PapyrusVR::VRDevice_LeftController && mLeftControllerPose->bPoseIsValid)
+	PapyrusVR::Vector3 queryPositions[kMaxInteractionDevices];
+	int hoverSlots[kMaxInteractionDevices];
+	bool needFullQuery = false;
+
+	ExtractDevicePositions(poses, queryPositions);
+
+	for (int i = 0; i < numDevices; ++i)
 	{
-		currControllerPose = mLeftControllerPose;
+		queryPositions[i] = GetQueryPosition(poses.hmd, queryPositions[i]);
+
+		// temporal coherence: a device usually stays on the same quickslot for many frames, so test the last hovered slot first
+		const int lastSlot = mHoverState[i].mSlotIndex;
+		if (lastSlot >= 0 && mQuickslotGeometry.OverlapsSlot(queryPositions[i], localFrame, lastSlot))
+		{
+			hoverSlots[i] = lastSlot;
+		}
+		else
+		{
+			hoverSlots[i] = -1;
+			needFullQuery = true;
+		}
 	}
-	else if (deviceId == PapyrusVR::VRDevice_RightController && mRightControllerPose->bPoseIsValid)
+
+	// test all devices against the whole slot table in one pass, only if one of them left its slot
+	if (needFullQuery)
 	{
-		currControllerPose = mRightControllerPose;
+		mQuickslotGeometry.FindOverlaps(queryPositions, numDevices, localFrame, mOverlapBatch);
+		for (int i = 0; i < numDevices; ++i)
+		{
+			if (hoverSlots[i] < 0)
+			{
+				hoverSlots[i] = mOverlapBatch.firstHit[i];
+			}
+		}
 	}
-	else
+
+	for (int i = 0; i < (int)kMaxInteractionDevices; ++i)
 	{
-		QSLOG_INFO("No valid poses in button press! deviceId: %d", deviceId);
-		return nullptr;
+		SetHoverSlot(i, (i < numDevices) ? hoverSlots[i] : -1, poses.frameIndex);
 	}
+}
 
-	// find the relevant quickslot which is overlapped by the controllers current position
-	PapyrusVR::Vector3 controllerPos = GetPositionFromVRPose(currControllerPose);
-	CQuickslot* quickslot = FindQuickslot(controllerPos, mControllerRadius);
-	return quickslot;
+void	CQuickslotManager::SetHoverSlot(int device, int slotIndex, uint32_t frameIndex)
+{
+	ControllerHoverState& hoverState = mHoverState[device];
+	const int lastSlot = hoverState.mSlotIndex;
+
+	hoverState.mSlotIndex = slotIndex;
+	hoverState.mPacked.store(ControllerHoverState::Pack(frameIndex, slotIndex), std::memory_order_release);
+
+	// moving from one slot to another is an exit on the old slot and an enter on the new one (same per slot semantics as LocalOverlapObject::ComputeOverlapEvent)
+	if (slotIndex != lastSlot)
+	{
+		if (lastSlot >= 0)
+		{
+			OnHoverEvent(device, lastSlot, PapyrusVR::VROverlapEvent_OnExit);
+		}
+		if (slotIndex >= 0)
+		{
+			OnHoverEvent(device, slotIndex, PapyrusVR::VROverlapEvent_OnEnter);
+		}
+	}
 }
 
-bool	CQuickslotManager::ButtonPress(PapyrusVR::EVRButtonId buttonId, PapyrusVR::VRDevice deviceId)
+void	CQuickslotManager::OnHoverEvent(int device, int slotIndex, PapyrusVR::VROverlapEvent overlapEvent)
 {
+	const double kHapticTimeout = 1.0;
 
-	// check if relevant button was pressed, or if a menu was open and early exit
-	if (buttonId != mActivateButton || MenuChecker::isGameStopped() || !mInGame)
+	CQuickslot* quickslot = GetQuickslotByIndex(slotIndex);
+	if (!quickslot || overlapEvent != PapyrusVR::VROverlapEvent_OnEnter)
 	{
-		return false;
+		return;
 	}
 
-	CQuickslot* quickslot = FindQuickslotByDeviceId(deviceId);
+	// Do haptic response on enter (but not constantly when moving in and out at the edge, check for timeout)
+	if (mHapticOnOverlap && mVRSystem && mHoverQuickslotHapticTime > 0.0 && CUtil::GetSingleton().GetLastTime() - quickslot->mLastOverlapTime > kHapticTimeout)
+	{
+		StartHaptics(device, mHoverQuickslotHapticTime);
+	}
+}
+
+CQuickslot*	CQuickslotManager::FindQuickslotByDevice(int device)
+{
+	// find quickslot based on current device (copy out a consistent snapshot, the poses thread may be publishing a new one right now)
+	PoseSnapshot poses;
+
+	if (!mPosePublisher.Read(poses))
+	{
+		return nullptr;
+	}
+
+	if (device < 0 || device >= (int)poses.numDevices || !poses.devices[device].valid)
+	{
+		QSLOG_INFO("No valid poses in button press! device: %d", device);
+		return nullptr;
+	}
+
+	const InteractionDevicePose& currControllerPose = poses.devices[device];
+
+	// without extrapolation the hover record from ProcessFrame already holds the answer for these poses
+	if (!mPoseExtrapolation)
+	{
+		const uint64_t packedHover = mHoverState[device].mPacked.load(std::memory_order_acquire);
+		if (ControllerHoverState::UnpackFrameIndex(packedHover) == poses.frameIndex)
+		{
+			return GetQuickslotByIndex(ControllerHoverState::UnpackSlotIndex(packedHover));
+		}
+	}
+
+	// find the relevant quickslot which is overlapped by the controllers current position
+	PapyrusVR::Vector3 controllerPos = currControllerPose.position;
+
+	// input callbacks can arrive most of a frame after the poses were taken, predict where the controller is now for fast grabs
+	if (mPoseExtrapolation)
+	{
+		const float elapsedTime = (float)std::min<double>(std::max<double>(GetPoseClockTime() - poses.timestamp, 0.0), mMaxPoseExtrapolationTime);
+		controllerPos.x += currControllerPose.velocity.x * elapsedTime;
+		controllerPos.y += currControllerPose.velocity.y * elapsedTime;
+		controllerPos.z += currControllerPose.velocity.z * elapsedTime;
+	}
+
+	CQuickslot* quickslot = FindQuickslotAtControllerPos(poses.hmd, controllerPos);
 
 #if QS_DEBUG_FEATURES
-	CQuickslot* nearestQS = FindNearestQuickslot(controllerPos);
+	CQuickslot* nearestQS = mHMDLocalQuery ? nullptr : FindNearestQuickslot(controllerPos);
 	if (quickslot && nearestQS != quickslot)
 	{
 		QSLOG_INFO("nearest quickslot and FindQuickslot() were not the same!");
 	}
 #endif
 
+	return quickslot;
+}
+
+bool	CQuickslotManager::ButtonPress(PapyrusVR::EVRButtonId buttonId, int device)
+{
+
+	// check if relevant button was pressed, or if a menu was open and early exit
+	if (!IsBoundButton(buttonId) || !IsProcessingInput())
+	{
+		return false;
+	}
+
+	CQuickslot* quickslot = FindQuickslotByDevice(device);
+
 	if (quickslot)  // if there is one, track button hold time on quickslot ( DoActions moved to OnRelease event -> ButtonRelease() )
 	{
 		// increase press time on this quickslot
 		quickslot->mButtonHoldTime = CUtil::GetSingleton().GetLastTime();
+		quickslot->mHoldButton = buttonId;
 		
 		// TODO: fix logging here
 		//QSLOG_INFO("Found a quickslot at pos (%f,%f,%f) !", controllerPos.x, controllerPos.y, controllerPos.z);
@@ -266,219 +804,315 @@ bool	CQuickslotManager::ButtonPress(PapyrusVR::EVRButtonId buttonId, PapyrusVR::
 }
 
 
-bool	CQuickslotManager::ButtonRelease(PapyrusVR::EVRButtonId buttonId, PapyrusVR::VRDevice deviceId)
+bool	CQuickslotManager::ButtonRelease(PapyrusVR::EVRButtonId buttonId, int device)
 {
 	// check if relevant button was pressed, or if a menu was open and early exit
-	if (buttonId != mActivateButton || MenuChecker::isGameStopped() || !mInGame)
+	if (!IsBoundButton(buttonId) || !IsProcessingInput())
 	{
 		QSLOG_INFO("Menu open. Cancelling...");
 		return false;
 	}
 
-	CQuickslot* quickslot = FindQuickslotByDeviceId(deviceId);
+	CQuickslot* quickslot = FindQuickslotByDevice(device);
 
-	if (quickslot && quickslot->mButtonHoldTime > 0.0)  // only do action if the button was pressed on originally
+	if (quickslot && quickslot->mButtonHoldTime > 0.0 && quickslot->mHoldButton == buttonId)  // only do action if the same button was pressed on originally
 	{
-		if (quickslot->mCommand.mAction != CQuickslot::NO_ACTION || !quickslot->mOtherCommands.empty())
-		{			
-			QSLOG_INFO("Order is set to %d...", quickslot->mOrder);
-			if (quickslot->mOrder == CQuickslot::eOrderType::DEFAULT) // one action for each hand (right and left), and execute first one that is applicable
+		// the commands call into the VM and console, so they run on the game thread (see DispatchEvents)
+		QueueEvent(mInputEvents, kQuickslotEvent_Release, device, buttonId, (int)(quickslot - mQuickslotArray.data()));
+	}
+
+	// reset button hold time for all other quickslots held with this button, holds of other bindings are still in progress
+	for (auto it = mQuickslotArray.begin(); it != mQuickslotArray.end(); ++it)
+	{
+		if (it->mHoldButton == buttonId)
+		{
+			it->mButtonHoldTime = -1.0;
+		}
+	}
+
+	return quickslot != nullptr;
+}
+
+void	CQuickslotManager::RunQuickslotCommands(CQuickslot* quickslot, int device, int button)
+{
+	quickslot->mActionButton = button;
+
+	if (quickslot->mCommand.mAction != CQuickslot::NO_ACTION || !quickslot->mOtherCommands.empty())
+	{			
+		QSLOG_INFO("Order is set to %d...", quickslot->mOrder);
+		if (quickslot->mOrder == CQuickslot::eOrderType::DEFAULT) // one action for each hand (right and left), and execute first one that is applicable
+		{
+			for (UInt32 f = 0; f < quickslot->mCommand.mFormIDList.size(); f++)
 			{
-				for (UInt32 f = 0; f < quickslot->mCommand.mFormIDList.size(); f++)
+				if (quickslot->DoAction(quickslot->mCommand, f))
 				{
-					if (quickslot->DoAction(quickslot->mCommand, quickslot->mCommand.mFormIDList[f]))
-					{
-						break;
-					}
+					break;
 				}
-				for (UInt32 f = 0; f < quickslot->mCommandAlt.mFormIDList.size(); f++)
+			}
+			for (UInt32 f = 0; f < quickslot->mCommandAlt.mFormIDList.size(); f++)
+			{
+				if (quickslot->DoAction(quickslot->mCommandAlt, f))
 				{
-					if (quickslot->DoAction(quickslot->mCommandAlt, quickslot->mCommandAlt.mFormIDList[f]))
-					{
-						break;
-					}
+					break;
 				}
 			}
-			else if(quickslot->mOrder == CQuickslot::eOrderType::FIRST) // execute first one that is applicable
-			{
-				//Here we loop through the commands array to see if we can find an applicable formid to do the action with.
-				//DoAction returns bool value for us to check.
-				bool success = false;
-				for(UInt32 i=0; i<quickslot->mOtherCommands.size(); i++)
-				{					
-					for (UInt32 f = 0; f < quickslot->mOtherCommands[i].mFormIDList.size(); f++)
-					{
-						if (quickslot->DoAction(quickslot->mOtherCommands[i], quickslot->mOtherCommands[i].mFormIDList[f]))
-						{
-							success = true;
-							break;
-						}
-					}
-					
-					if(success)
+		}
+		else if(quickslot->mOrder == CQuickslot::eOrderType::FIRST) // execute first one that is applicable
+		{
+			//Here we loop through the commands array to see if we can find an applicable formid to do the action with.
+			//DoAction returns bool value for us to check.
+			bool success = false;
+			for(UInt32 i=0; i<quickslot->mOtherCommands.size(); i++)
+			{					
+				for (UInt32 f = 0; f < quickslot->mOtherCommands[i].mFormIDList.size(); f++)
+				{
+					if (quickslot->DoAction(quickslot->mOtherCommands[i], f))
 					{
+						success = true;
 						break;
 					}
 				}
+				
+				if(success)
+				{
+					break;
+				}
 			}
-			else if (quickslot->mOrder == CQuickslot::eOrderType::RANDOM) // execute random one that is applicable
+		}
+		else if (quickslot->mOrder == CQuickslot::eOrderType::RANDOM) // execute random one that is applicable
+		{
+			//Random function creates a possibilities array to select a random command and formid from that command.
+			//To ensure that possible variable is never selected again, possibilities array item is deleted after each false return from DoAction.
+			if (!quickslot->mOtherCommands.empty())
 			{
-				//Random function creates a possibilities array to select a random command and formid from that command.
-				//To ensure that possible variable is never selected again, possibilities array item is deleted after each false return from DoAction.
-				if (!quickslot->mOtherCommands.empty())
+				std::vector<int> possibilities(quickslot->mOtherCommands.size());
+				for (UInt32 i = 0; i < quickslot->mOtherCommands.size(); i++)
 				{
-					std::vector<int> possibilities(quickslot->mOtherCommands.size());
-					for (UInt32 i = 0; i < quickslot->mOtherCommands.size(); i++)
-					{
-						possibilities[i] = i;
-					}
+					possibilities[i] = i;
+				}
+
+				for (UInt32 i = 0; i < quickslot->mOtherCommands.size(); i++)
+				{
+					if (possibilities.empty())
+						break;
+					
+					bool success = false;
+					const int randIndex = randomGenerator(0, possibilities.size()-1);
 
-					for (UInt32 i = 0; i < quickslot->mOtherCommands.size(); i++)
+					int positionIndex = possibilities[randIndex];
+					if (!quickslot->mOtherCommands[positionIndex].mFormIDList.empty())
 					{
-						if (possibilities.empty())
-							break;
-						
-						bool success = false;
-						const int randIndex = randomGenerator(0, possibilities.size()-1);
+						std::vector<int> formIdPossibilities(quickslot->mOtherCommands[positionIndex].mFormIDList.size());
+						for (UInt32 p = 0; p < quickslot->mOtherCommands[positionIndex].mFormIDList.size(); p++)
+						{
+							formIdPossibilities[p] = p;
+						}
 
-						int positionIndex = possibilities[randIndex];
-						if (!quickslot->mOtherCommands[positionIndex].mFormIDList.empty())
+						for (UInt32 f = 0; f < quickslot->mOtherCommands[positionIndex].mFormIDList.size(); f++)
 						{
-							std::vector<int> formIdPossibilities(quickslot->mOtherCommands[positionIndex].mFormIDList.size());
-							for (UInt32 p = 0; p < quickslot->mOtherCommands[positionIndex].mFormIDList.size(); p++)
+							if (formIdPossibilities.empty())
+								break;
+
+							const int randFormIdIndex = randomGenerator(0, formIdPossibilities.size()-1);
+							int position2Index = formIdPossibilities[randFormIdIndex];
+							if (quickslot->DoAction(quickslot->mOtherCommands[positionIndex], position2Index))
 							{
-								formIdPossibilities[p] = p;
+								success = true;
+								break;
 							}
-
-							for (UInt32 f = 0; f < quickslot->mOtherCommands[positionIndex].mFormIDList.size(); f++)
+							else
 							{
-								if (formIdPossibilities.empty())
-									break;
-
-								const int randFormIdIndex = randomGenerator(0, formIdPossibilities.size()-1);
-								int position2Index = formIdPossibilities[randFormIdIndex];
-								if (quickslot->DoAction(quickslot->mOtherCommands[positionIndex], quickslot->mOtherCommands[positionIndex].mFormIDList[position2Index]))
-								{
-									success = true;
-									break;
-								}
-								else
-								{
-									formIdPossibilities.erase(std::remove(formIdPossibilities.begin(), formIdPossibilities.end(), position2Index), formIdPossibilities.end());
-								}
+								formIdPossibilities.erase(std::remove(formIdPossibilities.begin(), formIdPossibilities.end(), position2Index), formIdPossibilities.end());
 							}
 						}
-						if (success)
-						{
-							break;
-						}
-						else
-						{
-							possibilities.erase(std::remove(possibilities.begin(), possibilities.end(), positionIndex), possibilities.end());
-						}
+					}
+					if (success)
+					{
+						break;
+					}
+					else
+					{
+						possibilities.erase(std::remove(possibilities.begin(), possibilities.end(), positionIndex), possibilities.end());
 					}
 				}
-				
 			}
-			else if (quickslot->mOrder == CQuickslot::eOrderType::ALL) // execute all commands that are applicable
+			
+		}
+		else if (quickslot->mOrder == CQuickslot::eOrderType::ALL) // execute all commands that are applicable
+		{
+			//Here we loop through the commands array and call DoAction for all the commands. But only one of the formIds if multiple are supplied.
+			for (UInt32 i = 0; i<quickslot->mOtherCommands.size(); i++)
 			{
-				//Here we loop through the commands array and call DoAction for all the commands. But only one of the formIds if multiple are supplied.
-				for (UInt32 i = 0; i<quickslot->mOtherCommands.size(); i++)
+				for (UInt32 f = 0; f < quickslot->mCommand.mFormIDList.size(); f++)
 				{
-					for (UInt32 f = 0; f < quickslot->mCommand.mFormIDList.size(); f++)
+					if (quickslot->DoAction(quickslot->mOtherCommands[i], quickslot->mCommand, f)) //Use only one of the possible formIds.
 					{
-						if (quickslot->DoAction(quickslot->mOtherCommands[i], quickslot->mCommand.mFormIDList[f])) //Use only one of the possible formIds.
-						{
-							break;
-						}
+						break;
 					}
 				}
 			}
-			else if (quickslot->mOrder == CQuickslot::eOrderType::TOGGLE) //Skip currently equipped stuff and execute first one that is applicable
+		}
+		else if (quickslot->mOrder == CQuickslot::eOrderType::TOGGLE) //Skip currently equipped stuff and execute first one that is applicable
+		{
+			//This is almost the same as eOrderType::FIRST cause above. We also check if the form is currently equipped right now and skip it.
+			//If the user defines 2 items and selects this order, this makes them to toggle the spell, hence the order name.
+			bool success = false;
+			for (UInt32 i = 0; i<quickslot->mOtherCommands.size(); i++)
 			{
-				//This is almost the same as eOrderType::FIRST cause above. We also check if the form is currently equipped right now and skip it.
-				//If the user defines 2 items and selects this order, this makes them to toggle the spell, hence the order name.
-				bool success = false;
-				for (UInt32 i = 0; i<quickslot->mOtherCommands.size(); i++)
+				for (UInt32 f = 0; f < quickslot->mOtherCommands[i].mFormIDList.size(); f++)
 				{
-					for (UInt32 f = 0; f < quickslot->mOtherCommands[i].mFormIDList.size(); f++)
+					if (!FormCurrentlyEquipped(quickslot->mOtherCommands[i].mFormIDList[f]))
 					{
-						if (!FormCurrentlyEquipped(quickslot->mOtherCommands[i].mFormIDList[f]))
+						if (quickslot->DoAction(quickslot->mOtherCommands[i], f))
 						{
-							if (quickslot->DoAction(quickslot->mOtherCommands[i], quickslot->mOtherCommands[i].mFormIDList[f]))
-							{
-								success = true;
-								break;
-							}
+							success = true;
+							break;
 						}
 					}
+				}
 
-					if (success)
-					{
-						break;
-					}
+				if (success)
+				{
+					break;
 				}
 			}
 		}
-		else
-		{
-			QSLOG_INFO("No action set for this quickslot...");
-			// short haptic feedback if no action is set for the quickslot
-			vr::ETrackedControllerRole controllerRole = (deviceId == PapyrusVR::VRDevice_LeftController) ? vr::TrackedControllerRole_LeftHand : vr::TrackedControllerRole_RightHand;
+	}
+	else
+	{
+		QSLOG_INFO("No action set for this quickslot...");
+		// short haptic feedback if no action is set for the quickslot
+		StartHaptics(device, 0.2);
+	}
+}
 
-			StartHaptics(controllerRole, 0.2);
-		}
+CQuickslot*	 CQuickslotManager::FindQuickslot(const PapyrusVR::Vector3& pos)
+{
+	// check for sphere overlap against the packed geometry table, only touch the quickslot itself on a hit
+	return GetQuickslotByIndex(mQuickslotGeometry.FindFirstOverlap(pos, false));
+}
+
+// same as FindQuickslot but pos is in the HMD yaw-local frame, tested against the untransformed quickslot origins
+CQuickslot*	 CQuickslotManager::FindQuickslotLocal(const PapyrusVR::Vector3& localPos)
+{
+	return GetQuickslotByIndex(mQuickslotGeometry.FindFirstOverlap(localPos, true));
+}
+
+// find quickslot overlapped by a controller at world position controllerPos, using either the per-frame transformed quickslot positions or
+// (in HMD local query mode) by transforming only the controller position into the quickslot origin frame
+CQuickslot*	 CQuickslotManager::FindQuickslotAtControllerPos(const PapyrusVR::TrackedDevicePose& hmdPose, const PapyrusVR::Vector3& controllerPos)
+{
+	if (mHMDLocalQuery)
+	{
+		return FindQuickslotLocal(WorldToHMDYawLocal(hmdPose.mDeviceToAbsoluteTracking, controllerPos));
 	}
 
-	// reset button hold time for all other quickslots
-	for (auto it = mQuickslotArray.begin(); it != mQuickslotArray.end(); ++it)
+	return FindQuickslot(controllerPos);
+}
+
+// debugging helper func
+CQuickslot*  CQuickslotManager::FindNearestQuickslot(const PapyrusVR::Vector3 pos)
+{
+	float closestDistSqr = FLT_MAX;
+	CQuickslot* closestQuickslot = GetQuickslotByIndex(mQuickslotGeometry.FindNearest(pos, false, &closestDistSqr));
+
+	if (closestQuickslot)
 	{
-		it->mButtonHoldTime = -1.0;
+		QSLOG_INFO("Closest quickslot was %s at distance %f", closestQuickslot->mName.c_str(), sqrtf(closestDistSqr));
 	}
 
-	return quickslot != nullptr;
+	return closestQuickslot;
+}
+
+CQuickslot*	CQuickslotManager::GetQuickslotByIndex(int index)
+{
+	return (index >= 0 && index < (int)mQuickslotArray.size()) ? &mQuickslotArray[index] : nullptr;
 }
 
-CQuickslot*	 CQuickslotManager::FindQuickslot(const PapyrusVR::Vector3& pos, float radius)
+void	CQuickslotManager::RebuildBindings()
 {
-	const size_t numQuickslots = mQuickslotArray.size();
-	
-	for (size_t i = 0; i < numQuickslots; ++i)
+	auto activateBinding = std::find_if(mBindings.begin(), mBindings.end(), [this](const QuickslotBinding& binding) { return binding.mButton == mActivateButton; });
+	if (activateBinding == mBindings.end())
 	{
-		// check for sphere overlap with quickslot i
-		const float combinedRadius = (radius + mQuickslotArray[i].mRadius);
-		const float combinedRadiusSqr = combinedRadius * combinedRadius;
+		QuickslotBinding binding;
+		binding.mButton = mActivateButton;
+		mBindings.insert(mBindings.begin(), binding);
+	}
+	else if (activateBinding != mBindings.begin())
+	{
+		std::iter_swap(mBindings.begin(), activateBinding);
+	}
+
+	uint64_t bindingMask = 0;
+	uint64_t longPressMask = 0;
+	uint64_t analogBindingMask = 0;
+	for (auto& binding : mBindings)
+	{
+		bindingMask |= 1ull << binding.mButton;
+		longPressMask |= binding.mLongPress ? (1ull << binding.mButton) : 0;
 
-		if (DistBetweenVecSqr(pos, mQuickslotArray[i].mPosition) < combinedRadiusSqr)
+		// analog activation only for axis buttons (touchpad/trigger/grip...), the axis value is read from rAxis[axis].x
+		const int axis = binding.mButton - PapyrusVR::k_EButton_Axis0;
+		if (binding.mPressThreshold > 0.0f && axis >= 0 && axis < (int)vr::k_unControllerStateAxisCount)
+		{
+			binding.mReleaseThreshold = std::min<float>(binding.mReleaseThreshold, binding.mPressThreshold);
+			uint32_t pressBits, releaseBits;
+			memcpy(&pressBits, &binding.mPressThreshold, sizeof(pressBits));
+			memcpy(&releaseBits, &binding.mReleaseThreshold, sizeof(releaseBits));
+			mAxisThresholds[axis].store(((uint64_t)releaseBits << 32) | pressBits, std::memory_order_relaxed);
+			analogBindingMask |= 1ull << binding.mButton;
+		}
+		else if (binding.mPressThreshold > 0.0f)
 		{
-			return &mQuickslotArray[i];  // this quickslot is overlapping
+			QSLOG_ERR("Button %d is not an axis, ignoring pressthreshold", binding.mButton);
 		}
 	}
 
-	return nullptr;
+	mLongPressMask = longPressMask;
+	mAnalogBindingMask.store(analogBindingMask, std::memory_order_release);  // after the thresholds, a newly analog axis is never read with stale thresholds
+	mBindingMask.store(bindingMask, std::memory_order_relaxed);
+
+	QSLOG_INFO("Button bindings: %d, mask 0x%llx", (int)mBindings.size(), bindingMask);
 }
 
-// debugging helper func
-CQuickslot*  CQuickslotManager::FindNearestQuickslot(const PapyrusVR::Vector3 pos)
+uint64_t	CQuickslotManager::UpdateAnalogBindings(const vr::VRControllerState_t& state, uint64_t lastAnalogPressed) const
 {
-	const size_t numQuickslots = mQuickslotArray.size();
-	float closestDistSqr = FLT_MAX;
-	CQuickslot* closestQuickslot = nullptr;
+	const uint64_t analogBindingMask = mAnalogBindingMask.load(std::memory_order_acquire);
+	uint64_t analogPressed = 0;
 
-	for (size_t i = 0; i < numQuickslots; ++i)
+	for (uint32_t axis = 0; axis < vr::k_unControllerStateAxisCount; ++axis)
 	{
-
-		const float currDistSqr = DistBetweenVecSqr(pos, mQuickslotArray[i].mPosition);
-		if (currDistSqr < closestDistSqr)
+		const uint64_t buttonMask = 1ull << (vr::k_EButton_Axis0 + axis);
+		if (analogBindingMask & buttonMask)
 		{
-			closestDistSqr = currDistSqr;
-			closestQuickslot = &mQuickslotArray[i];
+			// hysteresis: once pressed, stay pressed until the value drops below the (lower) release threshold
+			const uint64_t thresholds = mAxisThresholds[axis].load(std::memory_order_relaxed);
+			const uint32_t thresholdBits = (lastAnalogPressed & buttonMask) ? (uint32_t)(thresholds >> 32) : (uint32_t)thresholds;
+			float threshold;
+			memcpy(&threshold, &thresholdBits, sizeof(threshold));
+			if (state.rAxis[axis].x >= threshold)
+			{
+				analogPressed |= buttonMask;
+			}
 		}
 	}
 
-	QSLOG_INFO("Closest quickslot was %s at distance %f", closestQuickslot->mName.c_str(), sqrtf(closestDistSqr));
+	return analogPressed;
+}
 
-	return closestQuickslot;
+// rebuild packed geometry table from quickslot array (after config load)
+void	CQuickslotManager::RebuildQuickslotGeometry()
+{
+	mQuickslotGeometry.Clear();
+	for (const auto& quickslot : mQuickslotArray)
+	{
+		mQuickslotGeometry.AddSlot(quickslot.mOrigin, quickslot.mRadius);
+	}
+	mQuickslotGeometry.Finalize(mControllerRadius);
+
+#if QS_DEBUG_FEATURES
+	CQuickslotGeometry::RunBenchmark();
+#endif
 }
 
 
@@ -499,36 +1133,290 @@ PapyrusVR::EVRButtonId CQuickslotManager::GetActivateButton() const
 }
 
 
+void	CQuickslotManager::SetInGame(bool flag)
+{
+	// new game or a save was loaded, the player inventory changed completely
+	if (flag)
+	{
+		mInventoryIndex.Invalidate();
+
+		// forms created at runtime (0xFF index) belong to the loaded save, so cached form pointers must be resolved again
+		for (auto& quickslot : mQuickslotArray)
+		{
+			quickslot.ResolveForms();
+		}
+
+#if QS_DEBUG_FEATURES
+		NativeQuery::RunBenchmark((Actor*)(*g_thePlayer));
+#endif
+	}
+
+	mInGame = flag;
+}
+
+bool	CQuickslotManager::PlayerHasItem(TESForm* itemForm)
+{
+	if (mUseInventoryIndex && mInventoryIndex.IsRegistered())
+	{
+		return mInventoryIndex.HasItem(itemForm->formID);
+	}
+
+	// same count the GetItemCount native returns, read straight from the player's container instead of going through the VM
+	return NativeQuery::GetItemCount((Actor*)(*g_thePlayer), itemForm) > 0;
+}
+
+bool	CQuickslotManager::PlayerKnowsSpell(TESForm* spellForm)
+{
+	// no index here: there is no spell learned event to keep one valid, and rebuilding it per activation costs the same scan as answering directly.
+	// The scan reads the player's spell lists in place, no VM call and no allocation
+	return NativeQuery::HasSpell((Actor*)(*g_thePlayer), spellForm);
+}
+
 void	CQuickslotManager::Reset()
 {
 	mQuickslotArray.clear();
+	mQuickslotGeometry.Clear();
+	mBindings.clear();
+
+	// drop events for the old layout (Reset runs on the game thread, same as DispatchEvents)
+	QuickslotEvent event;
+	while (mInputEvents.Pop(event) || mFrameEvents.Pop(event))
+	{
+	}
+
+	ResetHoverStates();
 
 	mInGame = false;
 }
 
+void	CQuickslotManager::ResetHoverStates()
+{
+	for (auto& hoverState : mHoverState)
+	{
+		hoverState.mSlotIndex = -1;
+		hoverState.mPacked.store(ControllerHoverState::Pack(0, -1), std::memory_order_release);
+	}
+}
+
+bool	CQuickslotManager::IsProcessingInput() const
+{
+	return mReplaying || (mInGame && !MenuChecker::isGameStopped());
+}
+
+// quickslot positions of the default vrcustomquickslots.xml, replays of the same trace then do the same work whatever layout is configured
+static const float kReplayTestSlotPositions[][3] =
+{
+	{ 0.2f, -0.2f, 0.3f }, { -0.2f, -0.2f, 0.3f }, { 0.3f, -0.9f, 0.0f }, { -0.3f, -0.9f, 0.0f },
+	{ 0.2f, -0.9f, 0.175f }, { -0.2f, -0.9f, 0.175f }, { 0.0f, 0.25f, 0.0f }
+};
+
+void	CQuickslotManager::BeginReplay()
+{
+	// every replayed frame is processed inline, a worker would skip frames when the replay outruns it
+	StopWorkerThread();
+
+	mReplaySavedQuickslots.swap(mQuickslotArray);
+	mQuickslotArray.clear();
+
+	char slotName[32];
+	for (size_t i = 0; i < ARRAYSIZE(kReplayTestSlotPositions); ++i)
+	{
+		sprintf_s(slotName, sizeof(slotName), "replay%d", (int)i);
+		const float* pos = kReplayTestSlotPositions[i];
+		mQuickslotArray.emplace_back(PapyrusVR::Vector3(pos[0], pos[1], pos[2]), mDefaultRadius, std::vector<CQuickslot::CQuickslotCmd>(), CQuickslot::DEFAULT, slotName);
+	}
+	RebuildQuickslotGeometry();
+
+	mReplaying = true;
+}
+
+void	CQuickslotManager::EndReplay()
+{
+	mReplaying = false;
+
+	mQuickslotArray.swap(mReplaySavedQuickslots);
+	mReplaySavedQuickslots.clear();
+	RebuildQuickslotGeometry();
+
+	// the hooks start from a clean state: no replayed events, hovers, haptics, poses or device mapping
+	QuickslotEvent event;
+	while (mInputEvents.Pop(event) || mFrameEvents.Pop(event))
+	{
+	}
+
+	ResetHoverStates();
+	std::fill(std::begin(mDeviceHapticTime), std::end(mDeviceHapticTime), 0.0);
+
+	mFrameIndex = 0;
+	mPosePublisher.Reset();
+
+	mLastInteractionDeviceRefreshTime = -1.0;
+	InvalidateInteractionDevices();
+
+	// hook latency of the replay is logged now instead of being mixed into the first window of live frames
+	mPosesHookProfiler.Flush();
+	mControllerHookProfiler.Flush();
+
+	if (mUseWorkerThread)
+	{
+		StartWorkerThread(mWorkerThreadCore);
+	}
+}
+
 void CQuickslot::PrintInfo()
 {
-	QSLOG_INFO("Quickslot (%s) position: (%f,%f,%f) radius: %f", this->mName.c_str(), mPosition.x, mPosition.y, mPosition.z, mRadius);
+	QSLOG_INFO("Quickslot (%s) origin: (%f,%f,%f) radius: %f", this->mName.c_str(), mOrigin.x, mOrigin.y, mOrigin.z, mRadius);
 }
 
-//Checks if player has the item in their inventory. Calls GetItemCount Native function and checks if it's bigger than 0.
+//Checks if player has the item in their inventory.
 bool CQuickslot::PlayerHasItem(TESForm * itemForm)
 {
-	return GetItemCount((*g_skyrimVM)->GetClassRegistry(), 0, (Actor*)(*g_thePlayer), itemForm) != 0;
+	return CQuickslotManager::GetSingleton().PlayerHasItem(itemForm);
+}
+
+// append the console commands equipping formId for a spell/shout command
+// SKSE's EquipManager only wraps item equips, there is no verified SkyrimVR address for the spell/shout equip functions, so these stay on the console
+static void AppendEquipCommands(const CQuickslot::CQuickslotCmd& cmd, UInt32 formId, ConsoleCommandList& outCommands)
+{
+	const char* slotNames[3] = { "default", "right", "left" };  // should match eSlotType
+	const size_t cmdBufferSize = 255;
+	char cmdBuffer[cmdBufferSize];
+
+	if (cmd.mAction == CQuickslot::EQUIP_SPELL)
+	{
+		if (cmd.mSlot == CQuickslot::SLOT_DEFAULT)  // equip in both hands if its slot default
+		{
+			sprintf_s(cmdBuffer, cmdBufferSize, "player.equipspell %x left", formId);
+			outCommands.emplace_back(cmdBuffer);
+
+			sprintf_s(cmdBuffer, cmdBufferSize, "player.equipspell %x right", formId);
+			outCommands.emplace_back(cmdBuffer);
+		}
+		else if (cmd.mSlot <= CQuickslot::SLOT_LEFTHAND)
+		{
+			sprintf_s(cmdBuffer, cmdBufferSize, "player.equipspell %x %s", formId, slotNames[CQuickslotManager::GetSingleton().GetEffectiveSlot(cmd.mSlot)]);
+			outCommands.emplace_back(cmdBuffer);
+		}
+	}
+	else if (cmd.mAction == CQuickslot::EQUIP_SHOUT)
+	{
+		sprintf_s(cmdBuffer, cmdBufferSize, "player.equipshout %x", formId);
+		outCommands.emplace_back(cmdBuffer);
+	}
+}
+
+void CQuickslot::PrepareCommand(CQuickslotCmd& cmd)
+{
+	ResolveForms(cmd);
+
+	std::shared_ptr<ConsoleCommandList> commands = std::make_shared<ConsoleCommandList>();
+	cmd.mPreparedCommandsPerForm = 0;
+
+	if (cmd.mAction == CONSOLE_CMD)
+	{
+		commands->emplace_back(cmd.mConsoleCommand);
+	}
+	else if (cmd.mAction == EQUIP_SPELL || cmd.mAction == EQUIP_SHOUT)
+	{
+		for (UInt32 formId : cmd.mFormIDList)
+		{
+			AppendEquipCommands(cmd, formId, *commands);
+		}
+		cmd.mPreparedCommandsPerForm = cmd.mFormIDList.empty() ? 0 : (uint32_t)(commands->size() / cmd.mFormIDList.size());
+	}
+
+	// replaced, never modified: actions queued before keep the old list alive
+	cmd.mPreparedCommands = commands;
+}
+
+void CQuickslot::PrepareCommands()
+{
+	PrepareCommand(mCommand);
+	PrepareCommand(mCommandAlt);
+	for (auto& cmd : mOtherCommands)
+	{
+		PrepareCommand(cmd);
+	}
+}
+
+void CQuickslot::ResolveForms(CQuickslotCmd& cmd)
+{
+	cmd.mFormList.clear();
+	cmd.mFormList.reserve(cmd.mFormIDList.size());
+	for (UInt32 formId : cmd.mFormIDList)
+	{
+		cmd.mFormList.emplace_back(LookupFormByID(formId));
+	}
+}
+
+void CQuickslot::ResolveForms()
+{
+	ResolveForms(mCommand);
+	ResolveForms(mCommandAlt);
+	for (auto& cmd : mOtherCommands)
+	{
+		ResolveForms(cmd);
+	}
+}
+
+// point the action at the prepared console commands of cmd for formId, formIndex is its index in cmd.mFormIDList or -1 if it is from another list
+static void SetPreparedCommands(const CQuickslot::CQuickslotCmd& cmd, UInt32 formId, int formIndex, QuickslotAction& outAction)
+{
+	if (cmd.mAction == CQuickslot::CONSOLE_CMD)
+	{
+		outAction.mConsoleCommands = cmd.mPreparedCommands;
+		outAction.mFirstConsoleCommand = 0;
+		outAction.mNumConsoleCommands = cmd.mPreparedCommands ? (uint32_t)cmd.mPreparedCommands->size() : 0;
+		return;
+	}
+
+	if (cmd.mAction != CQuickslot::EQUIP_SPELL && cmd.mAction != CQuickslot::EQUIP_SHOUT)
+	{
+		return;
+	}
+
+	if (cmd.mPreparedCommands && formIndex >= 0)
+	{
+		outAction.mConsoleCommands = cmd.mPreparedCommands;
+		outAction.mFirstConsoleCommand = (uint32_t)formIndex * cmd.mPreparedCommandsPerForm;
+		outAction.mNumConsoleCommands = cmd.mPreparedCommandsPerForm;
+	}
+	else
+	{
+		// formId is not from this command's list (ALL order runs every command with the formIds of the first one), format it now
+		std::shared_ptr<ConsoleCommandList> commands = std::make_shared<ConsoleCommandList>();
+		AppendEquipCommands(cmd, formId, *commands);
+
+		outAction.mConsoleCommands = commands;
+		outAction.mFirstConsoleCommand = 0;
+		outAction.mNumConsoleCommands = (uint32_t)commands->size();
+	}
 }
 
-bool CQuickslot::DoAction(const CQuickslotCmd& cmd, UInt32 formId)
+bool CQuickslot::DoAction(const CQuickslotCmd& cmd, const CQuickslotCmd& formSource, size_t formIndex)
 {
+	const UInt32 formId = formSource.mFormIDList[formIndex];
+	// resolved at config / game load, only forms added to the list since then are looked up here
+	TESForm* formObj = (formIndex < formSource.mFormList.size()) ? formSource.mFormList[formIndex] : LookupFormByID(formId);
+
+	// command is bound to another button than the one used on the slot, treat as not applicable so the order logic moves on
+	if (cmd.mButton >= 0 && cmd.mButton != mActionButton)
+	{
+		return false;
+	}
+
+	QuickslotAction action;
+	action.mAction = cmd.mAction;
+
 	if (cmd.mAction == EQUIP_ITEM)
 	{
-		TESForm* itemFormObj = LookupFormByID(formId);
+		TESForm* itemFormObj = formObj;
 		if (itemFormObj != nullptr)
 		{
 			if (PlayerHasItem(itemFormObj)) //We check if player has the item and return false if they do not.
 			{
 				QSLOG_INFO("Equipping item formId: %x", formId);
-				// Use papyrus equip in task delegate for stability reasons
-				g_task->AddTask(new taskActorEquipItem(itemFormObj));
+				action.mForm = itemFormObj;
 			}
 			else
 			{
@@ -544,14 +1432,14 @@ bool CQuickslot::DoAction(const CQuickslotCmd& cmd, UInt32 formId)
 	}
 	else if(cmd.mAction == EQUIP_OTHER)
 	{		
-		TESForm* itemFormObj = LookupFormByID(formId);		
+		TESForm* itemFormObj = formObj;		
 		if (itemFormObj != nullptr)
 		{
 			QSLOG_INFO("Checking if player has object with formid: %x", formId);
 			if (PlayerHasItem(itemFormObj)) //We check if player has the item and return false if they do not.
 			{
 				QSLOG_INFO("Equipping item formId: %x", formId);
-				g_task->AddTask(new taskActorEquipItem(itemFormObj));
+				action.mForm = itemFormObj;
 			}
 			else
 			{
@@ -567,14 +1455,15 @@ bool CQuickslot::DoAction(const CQuickslotCmd& cmd, UInt32 formId)
 	}
 	else if (cmd.mAction == DROP_OBJECT)
 	{
-		TESForm* itemFormObj = LookupFormByID(formId);
+		TESForm* itemFormObj = formObj;
 		if (itemFormObj != nullptr)
 		{
 			QSLOG_INFO("Checking if player has object with formid: %x", formId);
 			if (PlayerHasItem(itemFormObj)) //We check if player has the item and return false if they do not.
 			{
 				QSLOG_INFO("Dropping item formId: %x", formId);
-				DropObject((*g_skyrimVM)->GetClassRegistry(), 0, (Actor*)(*g_thePlayer), itemFormObj, cmd.mCount);
+				action.mForm = itemFormObj;
+				action.mCount = cmd.mCount;
 			}
 			else
 			{
@@ -590,29 +1479,22 @@ bool CQuickslot::DoAction(const CQuickslotCmd& cmd, UInt32 formId)
 	}
 	else if (cmd.mAction == EQUIP_SPELL)
 	{
-		TESForm * spellForm = LookupFormByID(formId);
+		TESForm * spellForm = formObj;
 
 		if (spellForm != nullptr)
 		{
 			//Check if player knows the spell to prevent cheating (special allowance for spellsiphon though)
-			if ( (GetModIndex(formId) == CQuickslotManager::GetSingleton().GetSpellsiphonModIndex()) || HasSpell((*g_skyrimVM)->GetClassRegistry(), 0, (Actor*)(*g_thePlayer), spellForm))
+			if ( (GetModIndex(formId) == CQuickslotManager::GetSingleton().GetSpellsiphonModIndex()) || CQuickslotManager::GetSingleton().PlayerKnowsSpell(spellForm))
 			{
-				const char* slotNames[3] = { "default", "right", "left" };  // should match eSlotType
-				const size_t cmdBufferSize = 255;
-				char cmdBuffer[cmdBufferSize];
+				action.mForm = spellForm;
 
 				if (cmd.mSlot == SLOT_DEFAULT)  // equip in both hands if its slot default
 				{
-					sprintf_s(cmdBuffer, cmdBufferSize, "player.equipspell %x left", formId);
-					CSkyrimConsole::RunCommand(cmdBuffer);
-
-					sprintf_s(cmdBuffer, cmdBufferSize, "player.equipspell %x right", formId);
-					CSkyrimConsole::RunCommand(cmdBuffer);
+					action.mSlot = SLOT_DEFAULT;
 				}
 				else if (cmd.mSlot <= SLOT_LEFTHAND)
 				{
-					sprintf_s(cmdBuffer, cmdBufferSize, "player.equipspell %x %s", formId, slotNames[CQuickslotManager::GetSingleton().GetEffectiveSlot(cmd.mSlot)]);
-					CSkyrimConsole::RunCommand(cmdBuffer);
+					action.mSlot = CQuickslotManager::GetSingleton().GetEffectiveSlot(cmd.mSlot);
 				}
 				else
 				{
@@ -634,17 +1516,14 @@ bool CQuickslot::DoAction(const CQuickslotCmd& cmd, UInt32 formId)
 	}
 	else if (cmd.mAction == EQUIP_SHOUT)
 	{
-		TESForm * spellForm = LookupFormByID(formId);
+		TESForm * spellForm = formObj;
 
 		if (spellForm != nullptr)
 		{
 			//Check if player knows the shout to prevent cheating (same check for spellsiphon)
-			if ((GetModIndex(formId) == CQuickslotManager::GetSingleton().GetSpellsiphonModIndex()) || HasSpell((*g_skyrimVM)->GetClassRegistry(), 0, (Actor*)(*g_thePlayer), spellForm))
+			if ((GetModIndex(formId) == CQuickslotManager::GetSingleton().GetSpellsiphonModIndex()) || CQuickslotManager::GetSingleton().PlayerKnowsSpell(spellForm))
 			{
-				const size_t cmdBufferSize = 255;
-				char cmdBuffer[cmdBufferSize];
-				sprintf_s(cmdBuffer, cmdBufferSize, "player.equipshout %x", formId);
-				CSkyrimConsole::RunCommand(cmdBuffer);
+				action.mForm = spellForm;
 			}
 			else
 			{
@@ -658,14 +1537,15 @@ bool CQuickslot::DoAction(const CQuickslotCmd& cmd, UInt32 formId)
 			return false;
 		}
 	}
-	else if (cmd.mAction == CONSOLE_CMD)
-	{
-		CSkyrimConsole::RunCommand(cmd.mConsoleCommand.c_str());
-	}
-	else
+	else if (cmd.mAction != CONSOLE_CMD)
 	{
 		return false;
 	}
+
+	SetPreparedCommands(cmd, formId, (&formSource == &cmd) ? (int)formIndex : -1, action);
+
+	// checks passed, the action itself runs with all other actions of this frame (see taskQuickslotActions)
+	CQuickslotManager::GetSingleton().QueueAction(action);
 	return true;
 }
 
@@ -714,12 +1594,14 @@ void CQuickslot::SetAction(PapyrusVR::VRDevice deviceId)
 	if (mOrder == TOGGLE && mOtherCommands.size() > 0)
 	{
 		SetCommand(mOtherCommands[0]);
+		PrepareCommand(mOtherCommands[0]);
 
 		QSLOG("Set new action formid=%x on quickslot %s, slotID=%d effectiveSlot=%d for TOGGLE order mode", formObj->formID, this->mName.c_str(), slot, effectiveSlot);
 	}
 	else
 	{
 		SetCommand(mCommand);
+		PrepareCommand(mCommand);
 
 		QSLOG("Set new action formid=%x on quickslot %s, slotID=%d effectiveSlot=%d", formObj->formID, this->mName.c_str(), slot, effectiveSlot);
 	}
@@ -748,29 +1630,103 @@ void CQuickslot::UnsetAction()
 	if (mOrder == TOGGLE && mOtherCommands.size() > 0)
 	{
 		UnsetCommand(mOtherCommands[0]);
+		PrepareCommand(mOtherCommands[0]);
 	}
 	else
 	{
 		UnsetCommand(mCommand);
 		UnsetCommand(mCommandAlt);
+		PrepareCommand(mCommand);
+		PrepareCommand(mCommandAlt);
 	}
 }
 
-//ActorEquipItem TaskDelegate functions
-taskActorEquipItem::taskActorEquipItem(TESForm* akItem)
+//Console queue TaskDelegate functions
+void taskRunConsoleQueue::Run()
+{
+	CQuickslotManager::GetSingleton().RunConsoleQueue();
+}
+
+void taskRunConsoleQueue::Dispose()
+{
+	// static instance, nothing to free
+}
+
+//Quickslot event dispatch TaskDelegate functions
+void taskDispatchQuickslotEvents::Run()
+{
+	CQuickslotManager::GetSingleton().DispatchEvents();
+}
+
+void taskDispatchQuickslotEvents::Dispose()
 {
-	m_akItem = akItem;
+	// static instance, nothing to free
 }
 
-void taskActorEquipItem::Run()
+//Quickslot action batch TaskDelegate functions
+void taskQuickslotActions::Run()
 {
-	ActorEquipItem((*g_skyrimVM)->GetClassRegistry(), 0, (Actor*)(*g_thePlayer), m_akItem, false, false);
+	CQuickslotManager& manager = CQuickslotManager::GetSingleton();
+
+	for (size_t i = 0; i < mNumActions; ++i)
+	{
+		const QuickslotAction& action = mActions[i];
+
+		// console commands of consecutive actions go to the console together, anything else runs after the commands queued before it.
+		// Spells and shouts are equipped through console commands.
+		const bool useConsole = (action.mAction == CQuickslot::CONSOLE_CMD) || (action.mAction == CQuickslot::EQUIP_SPELL) || (action.mAction == CQuickslot::EQUIP_SHOUT);
+
+		if (useConsole)
+		{
+			manager.QueueConsoleCommands(action.mConsoleCommands, action.mFirstConsoleCommand, action.mNumConsoleCommands);
+			continue;
+		}
+
+		// the frame budget only spreads out console commands with nothing queued behind them, everything queued before an equip/drop
+		// must have run before it (a slot mixing console commands and equips keeps its order)
+		manager.RunConsoleQueue(true);
+
+		switch (action.mAction)
+		{
+		case CQuickslot::EQUIP_ITEM:
+		case CQuickslot::EQUIP_OTHER:
+			// Use papyrus equip in task delegate for stability reasons
+			ActorEquipItem((*g_skyrimVM)->GetClassRegistry(), 0, (Actor*)(*g_thePlayer), action.mForm, false, false);
+			break;
+
+		case CQuickslot::DROP_OBJECT:
+			DropObject((*g_skyrimVM)->GetClassRegistry(), 0, (Actor*)(*g_thePlayer), action.mForm, action.mCount);
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	manager.RunConsoleQueue();
 }
 
-void taskActorEquipItem::Dispose()
+void taskQuickslotActions::ClearActions()
 {
-	delete this;
+	// drop the command list references, the actions themselves stay allocated for the next batch
+	for (size_t i = 0; i < mNumActions; ++i)
+	{
+		mActions[i].mConsoleCommands.reset();
+	}
+	mNumActions = 0;
 }
 
+void taskQuickslotActions::Dispose()
+{
+	CQuickslotManager::GetSingleton().ReleaseActionTask(this);
+}
 
+QuickslotAction& taskQuickslotActions::AddAction()
+{
+	if (mNumActions == mActions.size())
+	{
+		mActions.emplace_back();
+	}
 
+	return mActions[mNumActions++];
+}
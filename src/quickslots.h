@@ -26,6 +26,9 @@
 #include "api/VRHookAPI.h"
 #include <string>
 #include <vector>
+#include <atomic>
+#include <memory>
+#include <thread>
 
 #include "skse64/InternalTasks.h"
 #include "skse64/PapyrusEvents.h"
@@ -33,6 +36,11 @@
 
 #include "timer.h"
 #include "quickslotutil.h"
+#include "posetrace.h"
+#include "posesnapshot.h"
+#include "quickslotgeometry.h"
+#include "spscqueue.h"
+#include "inventoryindex.h"
 
 // forward decl
 namespace vr
@@ -40,6 +48,8 @@ namespace vr
 	class IVRSystem;
 }
 
+typedef std::vector<std::string> ConsoleCommandList;
+
 class CQuickslot
 {
 	friend class CQuickslotManager;
@@ -99,12 +109,20 @@ public:
 		int mFood = 1;
 		int mPoison = 1;
 		int mCount = 1;
+		int mButton = -1;  // only run when the slot was activated with this button (EVRButtonId of a binding), -1 for any binding
+
+		// console commands formatted once by CQuickslot::PrepareCommand(): the console command itself, or mPreparedCommandsPerForm
+		// equip commands for each mFormIDList entry (spell/shout console fallback).  Never modified once built, queued actions keep a reference.
+		std::shared_ptr<const ConsoleCommandList> mPreparedCommands;
+		uint32_t mPreparedCommandsPerForm = 0;
+
+		// mFormIDList resolved by CQuickslot::ResolveForms() (same order, nullptr for forms missing from the loaded game), so presses need no form lookups
+		std::vector<TESForm*> mFormList;
 	};
 
 	CQuickslot() = default;
 	CQuickslot(PapyrusVR::Vector3 pos, float radius, const std::vector<CQuickslotCmd>& cmdList, int order, const char* name = nullptr)
 	{
-		mPosition = pos;
 		mOrigin = pos;
 		mRadius = radius;
 		mOrder = order;
@@ -134,13 +152,19 @@ public:
 	}
 
 	void PrintInfo();  // log information about this quickslot (debugging)
-	bool DoAction(const CQuickslotCmd& cmd, UInt32 formId);  // perform set quickslot action (call on button press)
+	// perform set quickslot action with form formIndex of formSource (call on button press), formSource is cmd itself except for ALL order
+	bool DoAction(const CQuickslotCmd& cmd, const CQuickslotCmd& formSource, size_t formIndex);
+	bool DoAction(const CQuickslotCmd& cmd, size_t formIndex) { return DoAction(cmd, cmd, formIndex); }
 	void SetAction(PapyrusVR::VRDevice deviceId); // set quickslot action to currently used item or spell
 	void UnsetAction();  // unset the action (remove any action from the slot, the user can later equip it with a new action)
 	bool PlayerHasItem(TESForm * itemForm); //Checks if player has the item
+	void PrepareCommands();  // (re)build the console commands and resolve the forms of all commands, after config load
+	static void PrepareCommand(CQuickslotCmd& cmd);
+	void ResolveForms();  // re-resolve the forms of all commands, after a game was loaded (runtime created forms change between saves)
+	static void ResolveForms(CQuickslotCmd& cmd);
 
 protected:
-	PapyrusVR::Vector3	mPosition;		// current position of quickslot (center of sphere)
+	// NOTE: per frame transformed position lives in CQuickslotManager::mQuickslotGeometry
 	PapyrusVR::Vector3	mOrigin;		// original position (before transforming to be relative to HMD)
 	float				mRadius = 0.0f;	// radius of sphere
 	CQuickslotCmd		mCommand;   // one command to equip each hand
@@ -149,6 +173,8 @@ protected:
 	std::string			mName;			// name of quickslot for debugging
 	double				mLastOverlapTime = 0.0;  // last overlap time
 	double				mButtonHoldTime = 0.0; // track time user held button on this quickslot
+	int					mHoldButton = -1;  // binding button (EVRButtonId) that started the current press
+	int					mActionButton = -1;  // binding button the commands currently being run were activated with (game thread, checked by DoAction)
 	int					mOrder = eOrderType::DEFAULT; //Order to select which commands to execute. 0 means default usage with one command to equip each hand.
 										//1 means execute first one that is applicable(item in user's inventory, player knows the spell/shout etc.)
 										//2 means execute random one that is applicable(item in user's inventory, player knows the spell/shout etc.)
@@ -158,6 +184,100 @@ protected:
 };
 
 
+// Quickslot an interaction device is hovering over, computed once per frame in ProcessFrame() so input hooks do not need to redo the overlap query
+struct ControllerHoverState
+{
+	static uint64_t	Pack(uint32_t frameIndex, int slotIndex) { return ((uint64_t)frameIndex << 32) | (uint32_t)slotIndex; }
+	static uint32_t	UnpackFrameIndex(uint64_t packed) { return (uint32_t)(packed >> 32); }
+	static int		UnpackSlotIndex(uint64_t packed) { return (int)(uint32_t)packed; }
+
+	std::atomic<uint64_t>	mPacked = { Pack(0, -1) };  // frame index and slot index in one word, so other threads always see a matching pair
+	int						mSlotIndex = -1;			// same slot index, only used by the frame processing thread
+};
+
+// A controller button that activates quickslots: press + release runs the slot commands, holding it edits the slot
+struct QuickslotBinding
+{
+	PapyrusVR::EVRButtonId	mButton = PapyrusVR::k_EButton_SteamVR_Trigger;
+	int						mLongPress = 1;  // allow long press editing with this button
+	float					mPressThreshold = 0.0f;		// if > 0 and mButton is an axis button: activate when rAxis[mButton - k_EButton_Axis0].x reaches this, before the click
+	float					mReleaseThreshold = 0.0f;	// analog release below this value (hysteresis, <= mPressThreshold)
+};
+
+enum eQuickslotEventType
+{
+	kQuickslotEvent_Release = 0,	// binding released on a slot it was pressed on: run the slot commands
+	kQuickslotEvent_LongPress,		// binding held on a slot for the long press time: edit the slot
+};
+
+// Quickslot activation decided on an input/frame thread, carried out later on the game thread by CQuickslotManager::DispatchEvents()
+struct QuickslotEvent
+{
+	uint8_t		mType = kQuickslotEvent_Release;	// eQuickslotEventType
+	int8_t		mDevice = -1;		// eInteractionDevice
+	int16_t		mButton = -1;		// binding button (EVRButtonId)
+	int32_t		mSlotIndex = -1;	// index into the quickslot array
+};
+
+// One quickslot action decided by CQuickslot::DoAction(), carried out later by taskQuickslotActions
+struct QuickslotAction
+{
+	CQuickslot::eCmdActionType	mAction = CQuickslot::NO_ACTION;
+	TESForm*					mForm = nullptr;	// item, spell or shout (not used for console commands)
+	int							mSlot = CQuickslot::SLOT_DEFAULT;	// effective hand slot for spells, SLOT_DEFAULT equips both hands
+	int							mCount = 1;			// number of items to drop
+	std::shared_ptr<const ConsoleCommandList>	mConsoleCommands;	// CONSOLE_CMD, or console fallback of spells/shouts
+	uint32_t					mFirstConsoleCommand = 0;
+	uint32_t					mNumConsoleCommands = 0;
+};
+
+// drains the quickslot event queues on the game thread.  At most one is queued at a time (see CQuickslotManager::QueueEvent), so a single static instance is reused
+class taskDispatchQuickslotEvents : public TaskDelegate
+{
+public:
+	virtual void Run();
+	virtual void Dispose();
+};
+
+// runs queued console commands on the game thread, scheduled at most once per frame while commands are waiting (see CQuickslotManager::RunConsoleQueue)
+class taskRunConsoleQueue : public TaskDelegate
+{
+public:
+	virtual void Run();
+	virtual void Dispose();
+};
+
+// range of prepared console commands waiting in CQuickslotManager's console queue
+struct QueuedConsoleCommands
+{
+	std::shared_ptr<const ConsoleCommandList>	mCommands;
+	uint32_t									mFirst = 0;
+	uint32_t									mCount = 0;
+};
+
+// all actions decided in one DispatchEvents() call (one frame worth of input), executed together in a single game thread task.
+// Instances come from CQuickslotManager's task pool and go back to it in Dispose(), action and command arrays keep their buffers between uses.
+class taskQuickslotActions : public TaskDelegate
+{
+public:
+	virtual void Run();
+	virtual void Dispose();
+
+	QuickslotAction&	AddAction();
+	void				ClearActions();
+	bool				HasActions() const { return mNumActions > 0; }
+
+	taskQuickslotActions*	mNextFree = nullptr;	// intrusive free list link while in the pool
+	bool					mPooled = false;		// false for overflow instances allocated when the pool was empty
+
+private:
+	std::vector<QuickslotAction>	mActions;		// only the first mNumActions are valid
+	size_t							mNumActions = 0;
+};
+
+static_assert(kMaxInteractionDevices <= QuickslotOverlapBatch::kMaxPoints, "overlap batch must fit every interaction device");
+static_assert(vr::k_unMaxTrackedDeviceCount <= 64, "tracked device masks are 64 bit");
+
 class CQuickslotManager: public ISingleton<CQuickslotManager>
 {
 
@@ -167,25 +287,52 @@ public:
 	bool			ReadConfig(const char* filename);
 	bool			WriteConfig(const char* filename);
 	bool			IsTrackingDataValid() const;
-	CQuickslot*		FindQuickslot(const PapyrusVR::Vector3& pos, float radius);
+	CQuickslot*		FindQuickslot(const PapyrusVR::Vector3& pos);  // overlap with controller sphere at world position
+	CQuickslot*		FindQuickslotLocal(const PapyrusVR::Vector3& localPos);  // overlap with controller sphere in HMD yaw-local frame
+	CQuickslot*		FindQuickslotAtControllerPos(const PapyrusVR::TrackedDevicePose& hmdPose, const PapyrusVR::Vector3& controllerPos);
 	CQuickslot*		FindNearestQuickslot(const PapyrusVR::Vector3 pos); // debug helper func
-	// find out if a controller is hovering over a quickslot
-	CQuickslot*		FindQuickslotByDeviceId(PapyrusVR::VRDevice deviceId);
-
-	void			Update(PapyrusVR::TrackedDevicePose* hmdPose, PapyrusVR::TrackedDevicePose* leftCtrlPose, PapyrusVR::TrackedDevicePose* rightCtrlPose);
+	// find out if an interaction device (eInteractionDevice) is hovering over a quickslot
+	CQuickslot*		FindQuickslotByDevice(int device);
+
+	void			Update(const PoseSnapshot& poses);  // called once per frame from the poses hook
+	void			StartWorkerThread(int cpuCore); // move per frame processing off the poses hook onto a worker thread, pinned to cpuCore if >= 0
+	void			StopWorkerThread();
+	// hooks wrap every access to quickslot data in these, BeginHookAccess() returns false (skip the data this call) while a config reload rebuilds it
+	bool			BeginHookAccess();
+	void			EndHookAccess() { mHookAccessCount.fetch_sub(1, std::memory_order_release); }
 	// button press/release now return true depending if the button press was triggered on a quickslot (this is for new feature: consuming inputs when used on quickslots)
-	bool			ButtonPress(PapyrusVR::EVRButtonId buttonId, PapyrusVR::VRDevice deviceId);
-	bool			ButtonRelease(PapyrusVR::EVRButtonId buttonId, PapyrusVR::VRDevice deviceId);
+	bool			ButtonPress(PapyrusVR::EVRButtonId buttonId, int device);
+	bool			ButtonRelease(PapyrusVR::EVRButtonId buttonId, int device);
+	void			DispatchEvents(); // game thread: run the slot commands / edits queued by the input and frame threads
+	void			QueueAction(const QuickslotAction& action); // game thread: add to the action batch submitted at the end of DispatchEvents()
+	void			ReleaseActionTask(taskQuickslotActions* task); // game thread: return a finished action batch to the pool
+	// game thread: append console commands to the console queue, they run in order within the per frame console budget
+	void			QueueConsoleCommands(const std::shared_ptr<const ConsoleCommandList>& commands, uint32_t first, uint32_t count);
+	void			RunConsoleQueue(bool ignoreBudget = false); // game thread: run queued console commands until this frame's budget is used, or all of them
 	void			Reset(); // Reset quickslot manager data
+	// pose trace replay at startup: input is processed as if in game against a fixed test layout, activations never run commands (see DispatchEvents)
+	void			BeginReplay();
+	void			EndReplay();  // restore the config layout and drop the state the replayed frames left behind
 	
-	// start haptic response for <timeLenght>, pass in LeftHand or RightHand controller from enum
-	void			StartHaptics(vr::ETrackedControllerRole controller, double timeLength); 
-	void			UpdateHaptics(); // called every frame to update haptic response
+	// start haptic response for <timeLenght> on an interaction device (eInteractionDevice)
+	void			StartHaptics(int device, double timeLength); 
+	void			UpdateHaptics(uint32_t numDevices); // called every frame to update haptic response
 	int				GetEffectiveSlot(int inSlot); // Get effective slot to equip with, this mainly can change due to left handed mode and Skyrim VR's awkward left handed mode implementation
-	void			SetInGame(bool flag) { mInGame = flag; }
+	void			SetInGame(bool flag);  // true after load game / new game: invalidates the player indexes and re-resolves quickslot forms
+	CInventoryIndex& GetInventoryIndex() { return mInventoryIndex; }
+	bool			PlayerHasItem(TESForm* itemForm); // game thread: inventory index lookup, or a native container scan if the index is disabled or not receiving container events
+	bool			PlayerKnowsSpell(TESForm* spellForm); // game thread: spell or shout known, native scan of the player's spell lists
 	int				AllowEdit() const { return mAllowEditSlots; }
 	int				DisableRawAPI() const { return mDisableRawAPI; }
 	PapyrusVR::EVRButtonId GetActivateButton() const;
+	uint64_t		GetBindingMask() const { return mBindingMask.load(std::memory_order_relaxed); } // ulButtonPressed bits of all bindings
+	bool			IsBoundButton(PapyrusVR::EVRButtonId buttonId) const { return (GetBindingMask() & (1ull << buttonId)) != 0; }
+	bool			IsLongPressButton(int buttonId) const { return buttonId >= 0 && (mLongPressMask & (1ull << buttonId)) != 0; }
+	uint64_t		GetAnalogBindingMask() const { return mAnalogBindingMask.load(std::memory_order_relaxed); } // bindings activated by axis thresholds instead of the button bit
+	// analog binding button bits pressed in this controller state, given the bits pressed in the last state of the same device (for hysteresis)
+	uint64_t		UpdateAnalogBindings(const vr::VRControllerState_t& state, uint64_t lastAnalogPressed) const;
+	uint32_t		GetPoseSequence() const { return mPosePublisher.GetSequence(); } // changes every time new poses are published
+	bool			UsesPoseExtrapolation() const { return mPoseExtrapolation != 0; } // hit tests then also depend on the time of the call, not only on the poses
 
 	void			SetHookMgr(OpenVRHookManagerAPI* hookMgr) 
 	{ 
@@ -193,13 +340,92 @@ public:
 		mVRSystem = hookMgr->GetVRSystem();
 	}
 
+	// Cached interaction device <-> tracked device index mapping, so the hooks do not call into the OpenVR runtime every frame
+	vr::TrackedDeviceIndex_t GetInteractionDeviceIndex(int device) const { return mInteractionDeviceIndex[device].load(std::memory_order_relaxed); }
+	uint32_t		GetInteractionDeviceIndices(vr::TrackedDeviceIndex_t* outDeviceIndices) const; // fills kMaxInteractionDevices entries, returns number of devices in use
+	int				FindInteractionDevice(vr::TrackedDeviceIndex_t deviceIndex) const  // eInteractionDevice for a tracked device index, -1 if not used for interaction
+	{
+		return deviceIndex < vr::k_unMaxTrackedDeviceCount ? mTrackedDeviceToInteraction[deviceIndex].load(std::memory_order_relaxed) : -1;
+	}
+	static int		GetInteractionDeviceForVRDevice(PapyrusVR::VRDevice deviceId)  // legacy PapyrusVR device id -> eInteractionDevice
+	{
+		return (deviceId == PapyrusVR::VRDevice_LeftController) ? kInteractionDevice_LeftHand : (deviceId == PapyrusVR::VRDevice_RightController) ? kInteractionDevice_RightHand : -1;
+	}
+	void			UpdateInteractionDevices(const vr::TrackedDevicePose_t* poseArray, uint32_t poseCount); // call from poses hook before reading device poses
+	void			InvalidateInteractionDevices() { mInteractionDevicesDirty.store(true, std::memory_order_relaxed); } // call when the device setup may have changed
+	// call when a device that is not mapped sends input: refreshes the mapping once, devices the refresh did not map (HMD, unused trackers...) are ignored afterwards
+	void			ReportUnknownInputDevice(vr::TrackedDeviceIndex_t deviceIndex)
+	{
+		const uint64_t deviceBit = (deviceIndex < vr::k_unMaxTrackedDeviceCount) ? (1ull << deviceIndex) : 0;
+		if (deviceBit && !(mRejectedInputDevices.load(std::memory_order_relaxed) & deviceBit))
+		{
+			mUnknownInputDevices.fetch_or(deviceBit, std::memory_order_relaxed);
+			InvalidateInteractionDevices();
+		}
+	}
+
 	UInt32			GetSpellsiphonModIndex() { return mSpellsiphonModIndex; }
 
+	// hook instrumentation (only active when enabled in config)
+	CPoseTraceRecorder&	GetPoseTraceRecorder() { return mPoseTraceRecorder; }
+	const std::string&	GetPoseTraceReplayFile() const { return mPoseTraceReplayFile; }
+	CHookProfiler&		GetPosesHookProfiler() { return mPosesHookProfiler; }
+	CHookProfiler&		GetControllerHookProfiler() { return mControllerHookProfiler; }
+
 private:
 
 	void	GetVRSystem();
+	CQuickslot*	GetQuickslotByIndex(int index);  // nullptr if out of range
+	void	RebuildQuickslotGeometry();
+	void	RebuildBindings();  // after config load: make sure activatebutton is bound and update the masks
+	void	ProcessFrame(const PoseSnapshot& poses); // slot transforms, overlap tests, long press and haptics
+	bool	IsProcessingInput() const;  // in game without a menu open, or replaying a pose trace
+	void	ResetHoverStates();
+	void	BeginReload();  // block hook access to quickslot data and wait for hooks still using it
+	void	EndReload() { mReloading.store(false, std::memory_order_release); }
+	void	WorkerThreadMain();
+	void	RefreshInteractionDevices();
+	void	UpdateHoverStates(const PoseSnapshot& poses);
+	void	SetHoverSlot(int device, int slotIndex, uint32_t frameIndex);
+	void	OnHoverEvent(int device, int slotIndex, PapyrusVR::VROverlapEvent overlapEvent);
+	PapyrusVR::VRDevice	GetHandForDevice(int device) const { return device == kInteractionDevice_LeftHand ? PapyrusVR::VRDevice_LeftController : PapyrusVR::VRDevice_RightController; } // trackers edit slots like the right hand
+	PapyrusVR::Vector3	GetQueryPosition(const PapyrusVR::TrackedDevicePose& hmdPose, const PapyrusVR::Vector3& controllerPos) const;
+	template <typename TQueue>
+	void	QueueEvent(TQueue& queue, eQuickslotEventType type, int device, int button, int slotIndex);
+	void	RunQuickslotCommands(CQuickslot* quickslot, int device, int button);  // game thread
+	void	EditQuickslot(CQuickslot* quickslot, int device);  // game thread
 
 	std::vector<CQuickslot>			mQuickslotArray;  // array of all quickslot objects
+	CQuickslotGeometry				mQuickslotGeometry; // hot geometry of mQuickslotArray for overlap queries, same indices
+	QuickslotOverlapBatch			mOverlapBatch;		// per frame overlap results for all interaction devices (frame processing thread only)
+	ControllerHoverState			mHoverState[kMaxInteractionDevices];	// per device hovered quickslot, indexed by eInteractionDevice
+	uint32_t						mFrameIndex = 0;	// last frame index handed to the publisher (poses hook thread only)
+
+	// events for the game thread.  One queue per producer: button events come from the controller input callback (RAW hook or legacy PapyrusVR, never both),
+	// long press events from ProcessFrame (poses hook or worker thread)
+	static const size_t				kEventQueueSize = 64;
+	CSpscQueue<QuickslotEvent, kEventQueueSize>	mInputEvents;
+	CSpscQueue<QuickslotEvent, kEventQueueSize>	mFrameEvents;
+	std::atomic<bool>				mDispatchScheduled = { false };  // a dispatch task is queued and has not started draining yet
+	taskQuickslotActions*			mPendingActions = nullptr;  // actions decided by the current DispatchEvents() call (game thread only)
+
+	// action batch tasks in flight (queued, not yet run) come from here, so the action path does not allocate.  Game thread only.
+	static const size_t				kActionTaskPoolSize = 8;
+	taskQuickslotActions			mActionTaskPool[kActionTaskPoolSize];
+	taskQuickslotActions*			mFreeActionTasks = nullptr;
+	uint32_t						mActionTaskOverflows = 0;  // batches allocated on the heap because every pooled task was in flight
+
+	// console commands waiting to run (game thread only), entries before mConsoleQueueHead already ran
+	std::vector<QueuedConsoleCommands>	mConsoleQueue;
+	size_t							mConsoleQueueHead = 0;
+	std::vector<const char*>		mConsoleBatch;		// scratch for RunConsoleQueue
+	std::vector<double>				mConsoleCommandTimes;
+	std::atomic<bool>				mConsoleQueuePending = { false };	// commands left over for the next frame
+	std::atomic<bool>				mConsoleTaskScheduled = { false };
+	double							mConsoleFrameBudget = 0.0; // seconds of console commands per frame, 0 runs every command right away, commands queued ahead of an equip/drop always run before it
+	double							mMaxConsoleCommandTime = 0.0; // slowest console command so far (seconds)
+	double							mConsoleBudgetUsed = 0.0;	// console time spent in the frame of mConsoleBudgetSequence
+	uint32_t						mConsoleBudgetSequence = 0;	// pose sequence (frame) the budget was last used in
 
 	int								mLastVRError = 0;
 	vr::IVRSystem*					mVRSystem = nullptr;
@@ -207,13 +433,28 @@ private:
 	// VR hook manager for new RAW api
 	OpenVRHookManagerAPI*			mHookMgrAPI = nullptr;
 
+	// interaction device mapping cache (written by poses hook, read by controller state hook)
+	std::atomic<vr::TrackedDeviceIndex_t>	mInteractionDeviceIndex[kMaxInteractionDevices];	// eInteractionDevice -> tracked device index
+	std::atomic<int>				mTrackedDeviceToInteraction[vr::k_unMaxTrackedDeviceCount];		// tracked device index -> eInteractionDevice or -1
+	std::atomic<uint32_t>			mNumInteractionDevices = { kInteractionDevice_FirstTracker };
+	std::atomic<bool>				mInteractionDevicesDirty = { true };
+	std::atomic<uint64_t>			mUnknownInputDevices = { 0 };	// bit per tracked device index: sent input while unmapped, waiting for a refresh
+	std::atomic<uint64_t>			mRejectedInputDevices = { 0 };	// bit per tracked device index: still unmapped after a refresh, input is ignored
+	double							mLastInteractionDeviceRefreshTime = -1.0;
+	int								mUseTrackers = 0;  // also interact with quickslots through generic (Vive) trackers
+
 	float							mControllerRadius = 0.1f;  // default sphere radius for controller overlap
 	PapyrusVR::EVRButtonId			mActivateButton = PapyrusVR::k_EButton_SteamVR_Trigger;
+	std::vector<QuickslotBinding>	mBindings;  // from <binding> elements, plus the activatebutton binding (always first)
+	std::atomic<uint64_t>			mBindingMask = { 1ull << PapyrusVR::k_EButton_SteamVR_Trigger }; // read by the controller state hook
+	uint64_t						mLongPressMask = 1ull << PapyrusVR::k_EButton_SteamVR_Trigger;
+	std::atomic<uint64_t>			mAnalogBindingMask = { 0 };
+	// per axis press (low 32 bits) and release (high 32 bits) thresholds of analog bindings as float bits, written on config load and read by the
+	// controller state hook, so each pair is published with a single store
+	std::atomic<uint64_t>			mAxisThresholds[vr::k_unControllerStateAxisCount] = {};
 
-	// headset and controller tracking information from last update
-	PapyrusVR::TrackedDevicePose*	mHMDPose = nullptr;
-	PapyrusVR::TrackedDevicePose*	mLeftControllerPose = nullptr;
-	PapyrusVR::TrackedDevicePose*	mRightControllerPose = nullptr;
+	// headset and controller tracking information from last update (published by Update, read by input callbacks on other threads)
+	CPoseSnapshotPublisher			mPosePublisher;
 
 	int								mDebugLogVerb = 0;  // debug log verbosity - 0 means no logging
 	int								mHapticOnOverlap = 1;  // haptic feedback on quickslot overlap
@@ -222,13 +463,40 @@ private:
 	int								mDisableRawAPI = 0; // if true, do not attempt to load new Raw OpenVR API
 	float							mDefaultRadius = 0.1f;
 	bool							mInGame = false; // do not start processing until in-game (after load game or new game event from SKSE)	
+	bool							mReplaying = false; // pose trace replay in progress, set and cleared before the hooks are registered
+	std::vector<CQuickslot>			mReplaySavedQuickslots;  // config layout while the replay test layout is installed
 	double							mLongPressTime = 3.0;  // length of time to trigger long press action
 	double							mShortPressTime = 0.3; // lenght of time to trigger short press action (basically to check if more than a single click)
-	double							mControllerHapticTime[2] = { 0.0 };
+	double							mDeviceHapticTime[kMaxInteractionDevices] = { 0.0 };  // haptics end time per interaction device
 	double							mHoverQuickslotHapticTime = 0.05; // length of time to send haptics when hovering over a quickslot (disable if <= 0)
+	int								mHMDLocalQuery = 0; // hit test controllers in the quickslot origin frame instead of transforming every quickslot each frame
+	int								mPoseExtrapolation = 0; // extrapolate controller position by its velocity when hit testing button presses
+	double							mMaxPoseExtrapolationTime = 0.03; // never extrapolate further ahead than this (seconds)
 
 
 	UInt32							mSpellsiphonModIndex = 0;
+
+	CInventoryIndex					mInventoryIndex;
+	int								mUseInventoryIndex = 1;  // answer item checks from the inventory index instead of calling GetItemCount per candidate
+
+	std::string						mPoseTraceFile;  // if set, record raw poses and controller states from RAW API hooks to this file
+	std::string						mPoseTraceReplayFile;  // if set, replay this trace through the RAW API hooks once at startup and log frame latency percentiles
+	int								mProfileHooks = 0;  // log latency percentiles of the RAW API hooks
+	CPoseTraceRecorder				mPoseTraceRecorder;
+	CHookProfiler					mPosesHookProfiler;
+	CHookProfiler					mControllerHookProfiler;
+
+	int								mUseWorkerThread = 0; // run ProcessFrame on a worker thread instead of inside the poses hook
+	int								mWorkerThreadCore = -1; // cpu core to pin the worker thread to, -1 to let the OS decide
+	std::thread						mWorkerThread;
+	HANDLE							mWorkerThreadEvent = nullptr; // signalled by Update() when new poses were published
+	std::atomic<bool>				mWorkerThreadActive = { false };
+	std::atomic<bool>				mWorkerThreadQuit = { false };
+	std::atomic<int>				mInlineFrameCount = { 0 };  // poses hook calls that may process their frame inline (worker was not active when they checked)
+
+	// config reload vs hook threads (see BeginHookAccess)
+	std::atomic<bool>				mReloading = { false };
+	std::atomic<int>				mHookAccessCount = { 0 };  // hook calls currently using quickslot data
 };
 
 typedef bool(*_HasSpell)(VMClassRegistry * registry, UInt64 stackID, Actor *actor, TESForm *akSpell);
@@ -244,13 +512,3 @@ typedef TESObjectREFR*(*_DropObject)(VMClassRegistry * registry, UInt64 stackID,
 extern RelocAddr <_DropObject> DropObject;
 
 extern SKSETaskInterface	* g_task;
-
-class taskActorEquipItem : public TaskDelegate
-{
-public:
-	virtual void Run();
-	virtual void Dispose();
-
-	taskActorEquipItem(TESForm* akItem);
-	TESForm* m_akItem;
-};
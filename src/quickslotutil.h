@@ -40,6 +40,8 @@
 #include "skse64/GameRTTI.h"
 #include "skse64/GameExtraData.h"
 
+#include "nativequery.h"
+
 // Log config & macros
 enum eLogLevels
 {
@@ -150,7 +152,7 @@ inline float DistBetweenVec(const PapyrusVR::Vector3& a, const PapyrusVR::Vector
 }
 
 
-inline PapyrusVR::Vector3 GetPositionFromVRPose(PapyrusVR::TrackedDevicePose* pose)
+inline PapyrusVR::Vector3 GetPositionFromVRPose(const PapyrusVR::TrackedDevicePose* pose)
 {
 	PapyrusVR::Vector3 vector;
 
@@ -206,6 +208,34 @@ inline PapyrusVR::Vector3 MultMatrix33(const PapyrusVR::Matrix33& lhs, const Pap
 	return transformedVector;
 }
 
+// transform a world (tracking space) position into the HMD yaw-local frame that quickslot origins are defined in - the inverse of
+// rotating an origin around Y by the HMD heading and adding the HMD position.  Uses a normalized yaw (from the HMD right vector)
+// so the inverse is just the transpose.
+inline PapyrusVR::Vector3 WorldToHMDYawLocal(const PapyrusVR::Matrix34& hmdMat, const PapyrusVR::Vector3& worldPos)
+{
+	float c = hmdMat.m[0][0];
+	float s = -hmdMat.m[2][0];
+	const float lenSqr = c * c + s * s;
+
+	if (lenSqr > 1e-8f)
+	{
+		const float invLen = 1.0f / sqrtf(lenSqr);
+		c *= invLen;
+		s *= invLen;
+	}
+	else
+	{
+		c = 1.0f;
+		s = 0.0f;
+	}
+
+	const float dx = worldPos.x - hmdMat.m[0][3];
+	const float dy = worldPos.y - hmdMat.m[1][3];
+	const float dz = worldPos.z - hmdMat.m[2][3];
+
+	return PapyrusVR::Vector3(c * dx - s * dz, dy, s * dx + c * dz);
+}
+
 //Random number generator function
 inline size_t randomGenerator(size_t min, size_t max)
 {
@@ -372,34 +402,7 @@ inline BGSEquipSlot * GetEquipSlotById(SInt32 slotId)
 //Checks if supplied formId is currently equipped by the player. Checks item, spell, and shout equips.
 inline bool FormCurrentlyEquipped(UInt32 formId)
 {
-	Actor * player = (Actor*)(*g_thePlayer);
-	TESForm * rightEquipped = player->GetEquippedObject(false);
-	TESForm * leftEquipped = player->GetEquippedObject(true);
-
-	if (rightEquipped && rightEquipped->formID == formId)
-	{
-		return true;
-	}
-	else if (leftEquipped && leftEquipped->formID == formId)
-	{
-		return true;
-	}
-	else if(player->leftHandSpell && player->leftHandSpell->formID == formId)
-	{
-		return true;
-	}
-	else if (player->rightHandSpell && player->rightHandSpell->formID == formId)
-	{
-		return true;
-	}
-	else if (player->equippedShout && player->equippedShout->formID == formId)
-	{
-		return true;
-	}
-	else
-	{
-		return false;
-	}
+	return NativeQuery::IsEquipped((Actor*)(*g_thePlayer), formId);
 }
 
 //A modified version of SKSE EquipItemEx that returns whether or not the equip was successful.
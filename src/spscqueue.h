@@ -0,0 +1,85 @@
+/*
+	VRCustomQuickslots - VR Custom Quickslots SKSE extension for SkyrimVR
+	Copyright (C) 2018 L Frazer
+	https://github.com/lfrazer
+
+	This file is part of VRCustomQuickslots.
+
+	VRCustomQuickslots is free software: you can redistribute it and/or modify
+	it under the terms of the GNU Lesser General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	VRCustomQuickslots is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU Lesser General Public License for more details.
+
+	You should have received a copy of the GNU Lesser General Public License
+	along with VRCustomQuickslots.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+// Fixed size lock-free ring buffer for exactly one producer thread and one consumer thread.
+// Push() and Pop() never block or allocate, Push() fails when the queue is full.  Capacity must be a power of two.
+template <typename T, size_t Capacity>
+class CSpscQueue
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "CSpscQueue capacity must be a power of two");
+
+public:
+	// producer thread only
+	bool Push(const T& item)
+	{
+		const uint32_t tail = mTail.load(std::memory_order_relaxed);
+		if (tail - mCachedHead == Capacity)
+		{
+			// looks full, refresh our copy of the consumer position
+			mCachedHead = mHead.load(std::memory_order_acquire);
+			if (tail - mCachedHead == Capacity)
+			{
+				return false;
+			}
+		}
+
+		mItems[tail & kIndexMask] = item;
+		mTail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// consumer thread only
+	bool Pop(T& outItem)
+	{
+		const uint32_t head = mHead.load(std::memory_order_relaxed);
+		if (head == mCachedTail)
+		{
+			mCachedTail = mTail.load(std::memory_order_acquire);
+			if (head == mCachedTail)
+			{
+				return false;
+			}
+		}
+
+		outItem = mItems[head & kIndexMask];
+		mHead.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// approximate when called while the other thread is active
+	bool Empty() const { return mHead.load(std::memory_order_acquire) == mTail.load(std::memory_order_acquire); }
+
+private:
+	static const uint32_t kIndexMask = (uint32_t)Capacity - 1;
+
+	// producer and consumer state on separate cache lines, so the two threads do not keep stealing the line from each other
+	alignas(64) std::atomic<uint32_t>	mTail = { 0 };	// next slot to write (written by producer)
+	uint32_t							mCachedHead = 0;	// producer's last seen mHead
+	alignas(64) std::atomic<uint32_t>	mHead = { 0 };	// next slot to read (written by consumer)
+	uint32_t							mCachedTail = 0;	// consumer's last seen mTail
+	alignas(64) T						mItems[Capacity];
+};